@@ -0,0 +1,75 @@
+// logtool: inspect and rework HAL logs.
+//
+//   logtool <command> [options] <logs...>
+//
+// Run "logtool <command> -h" for the options of a command.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include "LogTool.h"
+
+namespace {
+
+struct Command {
+  const char* name;
+  int       (*run)(int argc, char** argv);
+  const char* help;
+};
+
+const Command kCommands[] = {
+  { "merge", MergeCommand, "Merge logs into one, ordered by time." },
+  { "slice", SliceCommand, "Cut a time range or streams out of a log." },
+  { "stats", StatsCommand, "Report statistics and problems of a log." },
+  { "recover", RecoverCommand, "Repair logs cut off by a crash." },
+};
+
+void Usage(const char* sProgram) {
+  fprintf(stderr, "Usage: %s <command> [options]\n\nCommands:\n", sProgram);
+  for (const Command& command : kCommands) {
+    fprintf(stderr, "  %-10s %s\n", command.name, command.help);
+  }
+  fprintf(stderr, "\nRun '%s <command> -h' for the options of a command.\n",
+          sProgram);
+}
+
+}  // namespace
+
+std::vector<std::string> InputArguments(
+    int argc, char** argv, const std::vector<std::string>& vValueOptions) {
+  std::vector<std::string> vInputs;
+  for (int ii = 1; ii < argc; ++ii) {
+    const std::string sArg = argv[ii];
+    if (sArg.empty() || sArg[0] != '-') {
+      vInputs.push_back(sArg);
+    } else if (std::find(vValueOptions.begin(), vValueOptions.end(), sArg) !=
+               vValueOptions.end()) {
+      ++ii;
+    }
+  }
+  return vInputs;
+}
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = 1;
+
+  if (argc < 2 || !strcmp(argv[1], "-h") || !strcmp(argv[1], "--help")) {
+    Usage(argv[0]);
+    return argc < 2 ? 1 : 0;
+  }
+
+  for (const Command& command : kCommands) {
+    if (!strcmp(argv[1], command.name)) {
+      return command.run(argc - 1, argv + 1);
+    }
+  }
+
+  fprintf(stderr, "Unknown command '%s'.\n\n", argv[1]);
+  Usage(argv[0]);
+  return 1;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Commands of logtool. Each gets the arguments following the command
+// name, the name itself in argv[0], and returns the exit status.
+
+/// Merge logs into one, ordered by time.
+int MergeCommand(int argc, char** argv);
+
+/// Cut a time range or some streams out of a log.
+int SliceCommand(int argc, char** argv);
+
+/// Report statistics and problems of each stream of a log.
+int StatsCommand(int argc, char** argv);
+
+/// Cut the truncated tail off logs and write their missing index.
+int RecoverCommand(int argc, char** argv);
+
+/// Arguments not starting with '-', other than the values following the
+/// options in `vValueOptions`, e.g. the input logs of a command.
+std::vector<std::string> InputArguments(
+    int argc, char** argv, const std::vector<std::string>& vValueOptions);
@@ -0,0 +1,77 @@
+#include <stdio.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <HAL/Messages/LogMerger.h>
+#include <HAL/Messages/Logger.h>
+#include <HAL/Utils/GetPot>
+
+#include "LogTool.h"
+
+namespace {
+
+void MergeUsage() {
+  fprintf(stderr,
+          "Usage: logtool merge [options] <in.log> <in.log>...\n"
+          "\n"
+          "Merges logs, e.g. recorded on different machines, into one log\n"
+          "ordered by time. Each log is streamed, so memory use doesn't\n"
+          "grow with their length.\n"
+          "\n"
+          "Options:\n"
+          "  -o <out.log>    Merged log to write (default merged.log).\n"
+          "  --device-time   Order by the sensors' device time rather than\n"
+          "                  the time messages were logged.\n"
+          "  --mmap          Read the logs through memory mappings.\n");
+}
+
+}  // namespace
+
+int MergeCommand(int argc, char** argv) {
+  GetPot cl(argc, argv);
+  if (cl.search(2, "-h", "--help")) {
+    MergeUsage();
+    return 0;
+  }
+
+  const std::string sOutput = cl.follow("merged.log", "-o");
+  const hal::LogMerger::MergeOrder eOrder = cl.search("--device-time") ?
+      hal::LogMerger::Merge_DeviceTime : hal::LogMerger::Merge_Timestamp;
+  const bool bMemoryMapped = cl.search("--mmap");
+  const std::vector<std::string> vInputs = InputArguments(argc, argv, {"-o"});
+  if (vInputs.empty()) {
+    MergeUsage();
+    return 1;
+  }
+
+  for (const std::string& sInput : vInputs) {
+    if (sInput == sOutput) {
+      fprintf(stderr, "Refusing to overwrite input log '%s'.\n",
+              sInput.c_str());
+      return 1;
+    }
+    if (!std::ifstream(sInput)) {
+      fprintf(stderr, "Can't open log '%s'.\n", sInput.c_str());
+      return 1;
+    }
+  }
+
+  hal::LogMerger merger(vInputs, eOrder);
+  merger.SetMemoryMapped(bMemoryMapped);
+
+  hal::Logger logger;
+  logger.LogToFile(sOutput);
+  const size_t nMerged = merger.MergeInto(&logger);
+  logger.StopLogging();
+
+  printf("Merged %zu messages of %zu logs into '%s'.\n", nMerged,
+         merger.NumLogs(), sOutput.c_str());
+  if (logger.messages_dropped() > 0) {
+    fprintf(stderr, "%zu messages could not be written.\n",
+            logger.messages_dropped());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,62 @@
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include <HAL/Messages/LogRecovery.h>
+#include <HAL/Utils/GetPot>
+
+#include "LogTool.h"
+
+namespace {
+
+void RecoverUsage() {
+  fprintf(stderr,
+          "Usage: logtool recover [options] <in.log>...\n"
+          "\n"
+          "Repairs logs whose logger died before closing them, e.g. on a\n"
+          "power loss: cuts off the truncated last record and writes the\n"
+          "missing index, in place. Logs which have their index are left\n"
+          "as they are. Manifests of segmented logs are completed too.\n"
+          "\n"
+          "Options:\n"
+          "  -n, --dry-run   Only report what would be done.\n");
+}
+
+}  // namespace
+
+int RecoverCommand(int argc, char** argv) {
+  GetPot cl(argc, argv);
+  if (cl.search(2, "-h", "--help")) {
+    RecoverUsage();
+    return 0;
+  }
+
+  const bool bDryRun = cl.search(2, "-n", "--dry-run");
+  const std::vector<std::string> vInputs = InputArguments(argc, argv, {});
+  if (vInputs.empty()) {
+    RecoverUsage();
+    return 1;
+  }
+
+  int status = 0;
+  for (const std::string& sInput : vInputs) {
+    hal::LogRecoveryResult result;
+    if (!hal::RecoverLog(sInput, bDryRun, &result)) {
+      fprintf(stderr, "%s: recovery failed.\n", sInput.c_str());
+      status = 1;
+      continue;
+    }
+
+    if (result.num_recovered == 0) {
+      printf("%s: nothing to recover.\n", sInput.c_str());
+    } else {
+      printf("%s: %s %zu of %zu file(s), %zu records kept, "
+             "%llu bytes cut.\n", sInput.c_str(),
+             bDryRun ? "would recover" : "recovered", result.num_recovered,
+             result.num_files, result.num_records,
+             static_cast<unsigned long long>(result.bytes_cut));
+    }
+  }
+  return status;
+}
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <HAL/Messages/LogSlice.h>
+#include <HAL/Utils/GetPot>
+#include <HAL/Utils/StringUtils.h>
+
+#include "LogTool.h"
+
+namespace {
+
+void SliceUsage() {
+  fprintf(stderr,
+          "Usage: logtool slice [options] <in.log>\n"
+          "\n"
+          "Cuts a time range and/or some of the streams out of a log (or\n"
+          "the manifest of a segmented log). Records are found through the\n"
+          "log's index and copied as they are.\n"
+          "\n"
+          "Options:\n"
+          "  -o <out.log>       Slice to write (default slice.log).\n"
+          "  -s <seconds>       Start of the range, in seconds after the\n"
+          "                     first message (default: start of log).\n"
+          "  -e <seconds>       End of the range, inclusive (default: end\n"
+          "                     of log).\n"
+          "  --absolute         -s and -e are message timestamps.\n"
+          "  --streams <list>   Comma separated payloads to keep, e.g.\n"
+          "                     camera,imu,lidar,pose (default all).\n"
+          "  --cameras <ids>    Comma separated camera ids to keep\n"
+          "                     (default all).\n");
+}
+
+}  // namespace
+
+int SliceCommand(int argc, char** argv) {
+  GetPot cl(argc, argv);
+  if (cl.search(2, "-h", "--help")) {
+    SliceUsage();
+    return 0;
+  }
+
+  hal::LogSliceOptions options;
+  const std::string sOutput = cl.follow("slice.log", "-o");
+  options.start_time = cl.follow(options.start_time, "-s");
+  options.end_time = cl.follow(options.end_time, "-e");
+  options.relative_times = !cl.search("--absolute");
+
+  for (const std::string& sStream : hal::Split(cl.follow("", "--streams"),
+                                               ',')) {
+    const google::protobuf::FieldDescriptor* pField =
+        hal::Msg::descriptor()->FindFieldByName(sStream);
+    if (sStream == "timestamp" || pField == nullptr) {
+      fprintf(stderr, "Unknown stream '%s'.\n", sStream.c_str());
+      return 1;
+    }
+    options.types.push_back(pField->number());
+  }
+  for (const std::string& sId : hal::Split(cl.follow("", "--cameras"), ',')) {
+    options.camera_ids.push_back(atoi(sId.c_str()));
+  }
+
+  const std::vector<std::string> vInputs =
+      InputArguments(argc, argv, {"-o", "-s", "-e", "--streams", "--cameras"});
+  if (vInputs.size() != 1) {
+    SliceUsage();
+    return 1;
+  }
+  if (vInputs[0] == sOutput) {
+    fprintf(stderr, "Refusing to overwrite input log '%s'.\n",
+            sOutput.c_str());
+    return 1;
+  }
+
+  size_t nRecords;
+  if (!hal::SliceLog(vInputs[0], sOutput, options, &nRecords)) {
+    fprintf(stderr, "Failed to slice '%s'.\n", vInputs[0].c_str());
+    return 1;
+  }
+
+  printf("Copied %zu records of '%s' into '%s'.\n", nRecords,
+         vInputs[0].c_str(), sOutput.c_str());
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include <stdio.h>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <HAL/Messages/LogStats.h>
+#include <HAL/Utils/GetPot>
+
+#include "LogTool.h"
+
+namespace {
+
+void StatsUsage() {
+  fprintf(stderr,
+          "Usage: logtool stats [options] <in.log>\n"
+          "\n"
+          "Reports message counts, rates, timing jitter, gaps, sizes and\n"
+          "image formats per stream of a log (or the manifest of a\n"
+          "segmented log) in one pass over its records, and checks it for\n"
+          "problems. Exits with status 2 if any are found.\n"
+          "\n"
+          "Options:\n"
+          "  --max-gap <n>   Flag gaps longer than n times a stream's\n"
+          "                  typical period (default 5).\n");
+}
+
+}  // namespace
+
+int StatsCommand(int argc, char** argv) {
+  GetPot cl(argc, argv);
+  if (cl.search(2, "-h", "--help")) {
+    StatsUsage();
+    return 0;
+  }
+
+  const double dMaxGap = cl.follow(5.0, "--max-gap");
+  const std::vector<std::string> vInputs =
+      InputArguments(argc, argv, {"--max-gap"});
+  if (vInputs.size() != 1) {
+    StatsUsage();
+    return 1;
+  }
+
+  hal::LogStats stats;
+  if (!stats.Scan(vInputs[0])) {
+    fprintf(stderr, "Failed to read '%s'.\n", vInputs[0].c_str());
+    return 1;
+  }
+
+  double dStart = std::numeric_limits<double>::infinity();
+  for (const auto& it : stats.streams()) {
+    dStart = std::min(dStart, it.second.first_time);
+  }
+
+  printf("%s: %llu file(s), %.1f MB, %llu indexed\n\n", vInputs[0].c_str(),
+         static_cast<unsigned long long>(stats.num_files()),
+         stats.num_bytes() / 1e6,
+         static_cast<unsigned long long>(stats.num_indexed()));
+  printf("%-14s %9s %9s %9s %9s %9s %10s %9s %6s\n", "stream", "messages",
+         "rate Hz", "MB", "p50 ms", "p99 ms", "max gap ms", "at s",
+         "back");
+
+  std::vector<std::string> vProblems;
+  for (const auto& it : stats.streams()) {
+    const std::string sName = hal::LogStats::StreamName(it.first);
+    const hal::LogStreamStats& stream = it.second;
+    const double dPeriod = stream.gaps.Quantile(0.5);
+    printf("%-14s %9llu %9.2f %9.1f %9.3f %9.3f %10.3f %9.3f %6llu\n",
+           sName.c_str(),
+           static_cast<unsigned long long>(stream.num_messages),
+           stream.Rate(), stream.num_bytes / 1e6, dPeriod * 1e3,
+           stream.gaps.Quantile(0.99) * 1e3, stream.max_gap * 1e3,
+           stream.max_gap_time - dStart,
+           static_cast<unsigned long long>(stream.num_backwards));
+
+    // Spread of the gaps around the typical period.
+    if (dPeriod > 0) {
+      const double vEdges[] = { 0.5, 0.9, 1.1, 1.5, 2.5 };
+      printf("  period x");
+      double dLow = -std::numeric_limits<double>::infinity();
+      for (double dEdge : vEdges) {
+        printf("  <%.1f: %llu", dEdge, static_cast<unsigned long long>(
+            stream.gaps.CountBetween(dLow, dEdge * dPeriod)));
+        dLow = dEdge * dPeriod;
+      }
+      printf("  >=2.5: %llu\n", static_cast<unsigned long long>(
+          stream.gaps.CountBetween(dLow,
+                                   std::numeric_limits<double>::infinity())));
+    }
+
+    for (const auto& format : stream.image_formats) {
+      printf("  image %s: %llu\n", format.first.c_str(),
+             static_cast<unsigned long long>(format.second));
+    }
+
+    if (stream.num_backwards > 0) {
+      vProblems.push_back(sName + ": " + std::to_string(stream.num_backwards) +
+                          " timestamps go back in time");
+    }
+    const uint64_t nLongGaps = dPeriod > 0 ? stream.gaps.CountBetween(
+        dMaxGap * dPeriod, std::numeric_limits<double>::infinity()) : 0;
+    if (nLongGaps > 0) {
+      vProblems.push_back(sName + ": " + std::to_string(nLongGaps) +
+                          " gaps longer than " + std::to_string(dMaxGap) +
+                          " periods");
+    }
+  }
+
+  if (stats.num_truncated() > 0) {
+    vProblems.push_back(std::to_string(stats.num_truncated()) +
+                        " file(s) end in a truncated record");
+  }
+  if (stats.num_indexed() < stats.num_files()) {
+    vProblems.push_back(
+        std::to_string(stats.num_files() - stats.num_indexed()) +
+        " file(s) have no index");
+  }
+
+  printf("\n");
+  if (vProblems.empty()) {
+    printf("No problems found.\n");
+    return 0;
+  }
+  for (const std::string& sProblem : vProblems) {
+    printf("Problem: %s.\n", sProblem.c_str());
+  }
+  return 2;
+}
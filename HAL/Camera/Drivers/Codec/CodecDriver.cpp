@@ -0,0 +1,110 @@
+#include "CodecDriver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include <glog/logging.h>
+
+#include <HAL/Messages/ImageCodec.h>
+
+namespace hal
+{
+
+namespace
+{
+
+/// A thread per channel, the capturing thread being one of them, is as
+/// many as a frame can keep busy.
+unsigned int NumThreads(unsigned int nThreads, size_t nChannels)
+{
+    if (nThreads == 0) {
+        nThreads = std::max<unsigned int>(
+            1, std::min<unsigned int>(nChannels,
+                                      std::thread::hardware_concurrency()));
+    }
+    return nThreads;
+}
+
+}
+
+CodecDriver::CodecDriver(std::shared_ptr<CameraDriverInterface> Input,
+                         hal::ImageCodec eCodec, int nLevel,
+                         hal::ImageCodec eDepthCodec, int nDepthLevel,
+                         unsigned int nThreads)
+    : m_Input(Input),
+      m_bEncode(true),
+      m_eCodec(eCodec),
+      m_nLevel(nLevel),
+      m_eDepthCodec(eDepthCodec),
+      m_nDepthLevel(nDepthLevel),
+      m_Workers(NumThreads(nThreads, Input->NumChannels()))
+{
+}
+
+CodecDriver::CodecDriver(std::shared_ptr<CameraDriverInterface> Input,
+                         unsigned int nThreads)
+    : m_Input(Input),
+      m_bEncode(false),
+      m_eCodec(hal::PB_CODEC_NONE),
+      m_nLevel(0),
+      m_eDepthCodec(hal::PB_CODEC_NONE),
+      m_nDepthLevel(0),
+      m_Workers(NumThreads(nThreads, Input->NumChannels()))
+{
+}
+
+bool CodecDriver::CodeImage(hal::ImageMsg* pImage) const
+{
+    if (!m_bEncode) {
+        return DecodeImage(pImage);
+    }
+    // Images the codec can't handle are passed on as they are.
+    if (IsDepthImage(*pImage) && m_eDepthCodec != hal::PB_CODEC_NONE) {
+        EncodeImage(m_eDepthCodec, m_nDepthLevel, pImage);
+    } else {
+        EncodeImage(m_eCodec, m_nLevel, pImage);
+    }
+    return true;
+}
+
+bool CodecDriver::Capture( hal::CameraMsg& vImages )
+{
+    if (!m_Input->Capture(vImages)) {
+        return false;
+    }
+
+    std::atomic<bool> bFailed(false);
+    m_Workers.Run(vImages.image_size(), [&](size_t ii) {
+        if (!CodeImage(vImages.mutable_image(ii))) {
+            bFailed = true;
+        }
+    });
+    if (bFailed) {
+        LOG(WARNING) << "HAL: Failed to decode images of a frame.";
+        return false;
+    }
+    return true;
+}
+
+std::string CodecDriver::GetDeviceProperty(const std::string& sProperty)
+{
+    return m_Input->GetDeviceProperty(sProperty);
+}
+
+size_t CodecDriver::NumChannels() const
+{
+    return m_Input->NumChannels();
+}
+
+size_t CodecDriver::Width( size_t idx ) const
+{
+    return m_Input->Width(idx);
+}
+
+size_t CodecDriver::Height( size_t idx ) const
+{
+    return m_Input->Height(idx);
+}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+
+#include <HAL/Camera.pb.h>
+#include <HAL/Utils/WorkerPool.h>
+#include "HAL/Camera/CameraDriverInterface.h"
+
+
+namespace hal
+{
+
+/**
+ * Compresses (encode://) or restores (decode://) every image captured
+ * from the input driver, with the codecs of HAL/Messages/ImageCodec.h.
+ *
+ * The channels of a frame are coded in parallel, on the capturing thread
+ * and a few worker threads owned by the driver (see hal::WorkerPool).
+ * Encoded images carry their codec in ImageMsg.codec, so they travel
+ * through the Logger, NodeCam or other drivers as they are, and
+ * hal::DecodeImage() or a decode:// driver turns them back into pixels.
+ */
+class CodecDriver : public CameraDriverInterface
+{
+public:
+    /// Encode with `eCodec`, or `eDepthCodec` for depth images unless it
+    /// is PB_CODEC_NONE, on `nThreads` threads in all.
+    CodecDriver(std::shared_ptr<CameraDriverInterface> Input,
+                hal::ImageCodec eCodec, int nLevel,
+                hal::ImageCodec eDepthCodec, int nDepthLevel,
+                unsigned int nThreads);
+
+    /// Decode on `nThreads` threads in all.
+    CodecDriver(std::shared_ptr<CameraDriverInterface> Input,
+                unsigned int nThreads);
+
+    bool Capture( hal::CameraMsg& vImages );
+    std::shared_ptr<CameraDriverInterface> GetInputDevice() { return m_Input; }
+
+    std::string GetDeviceProperty(const std::string& sProperty);
+
+    size_t NumChannels() const;
+    size_t Width( size_t idx = 0 ) const;
+    size_t Height( size_t idx = 0 ) const;
+
+protected:
+    bool CodeImage(hal::ImageMsg* pImage) const;
+
+    std::shared_ptr<CameraDriverInterface>  m_Input;
+    bool                                    m_bEncode;
+    hal::ImageCodec                         m_eCodec;
+    int                                     m_nLevel;
+    hal::ImageCodec                         m_eDepthCodec;
+    int                                     m_nDepthLevel;
+    WorkerPool                              m_Workers;
+};
+
+}
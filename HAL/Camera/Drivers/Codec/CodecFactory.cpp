@@ -0,0 +1,95 @@
+#include <HAL/Devices/DeviceFactory.h>
+#include <HAL/Devices/DeviceException.h>
+#include <HAL/Messages/ImageCodec.h>
+#include "CodecDriver.h"
+
+#include <string>
+
+namespace hal
+{
+
+class CodecFactory : public DeviceFactory<CameraDriverInterface>
+{
+public:
+    CodecFactory(const std::string& name)
+        : DeviceFactory<CameraDriverInterface>(name)
+    {
+        Params() = {
+            {"codec", DefaultCodec(), "encode: codec of the images: lz4, "
+                    "zstd, png, jpeg, depth16 or none. Defaults to the "
+                    "first of lz4, zstd and png built in."},
+            {"level", "0", "encode: codec level or quality (0 for default)."},
+            {"depth", "depth16", "encode: codec of 16-bit depth images "
+                                 "(none to use 'codec')."},
+            {"depth_level", "0", "encode: codec level of depth images."},
+            {"threads", "0", "Coding threads (0 for one per channel)."}
+        };
+    }
+
+    std::shared_ptr<CameraDriverInterface> GetDevice(const Uri& uri)
+    {
+        const unsigned int nThreads =
+                uri.properties.Get<unsigned int>("threads", 0);
+
+        hal::ImageCodec eCodec = hal::PB_CODEC_NONE;
+        hal::ImageCodec eDepthCodec = hal::PB_CODEC_NONE;
+        const bool bEncode = !uri.scheme.compare("encode");
+        if( bEncode ) {
+            eCodec = GetCodec(uri, "codec", DefaultCodec());
+            eDepthCodec = GetCodec(uri, "depth", "depth16");
+        }
+
+        // Create input camera
+        std::shared_ptr<CameraDriverInterface> Input =
+                DeviceRegistry<hal::CameraDriverInterface>::Instance().Create(
+                    Uri(uri.url));
+
+        CodecDriver* pDriver;
+        if( bEncode ) {
+            pDriver = new CodecDriver( Input,
+                    eCodec, uri.properties.Get<int>("level", 0),
+                    eDepthCodec, uri.properties.Get<int>("depth_level", 0),
+                    nThreads );
+        } else {
+            pDriver = new CodecDriver( Input, nThreads );
+        }
+        return std::shared_ptr<CameraDriverInterface>( pDriver );
+    }
+
+private:
+    /// The fastest lossless codec of this build: LZ4 and Zstd are
+    /// optional, PNG comes with OpenCV.
+    static std::string DefaultCodec()
+    {
+        if( IsImageCodecAvailable(hal::PB_CODEC_LZ4) ) {
+            return "lz4";
+        } else if( IsImageCodecAvailable(hal::PB_CODEC_ZSTD) ) {
+            return "zstd";
+        } else if( IsImageCodecAvailable(hal::PB_CODEC_PNG) ) {
+            return "png";
+        }
+        return "none";
+    }
+
+    static hal::ImageCodec GetCodec(const Uri& uri, const std::string& sKey,
+                                    const std::string& sDefault)
+    {
+        const std::string sName =
+                uri.properties.Get<std::string>(sKey, sDefault);
+        hal::ImageCodec codec;
+        if( !ParseImageCodec(sName, &codec) ) {
+            throw DeviceException("HAL: Error! Unknown image codec: " + sName);
+        }
+        if( !IsImageCodecAvailable(codec) ) {
+            throw DeviceException("HAL: Error! Image codec " + sName +
+                                  " is not available in this build.");
+        }
+        return codec;
+    }
+};
+
+// Register this factory by creating static instance of factory
+static CodecFactory g_EncodeFactory("encode");
+static CodecFactory g_DecodeFactory("decode");
+
+}
@@ -1,5 +1,7 @@
 #include "ConvertDriver.h"
 #include "HAL/Devices/DeviceException.h"
+#include "HAL/Messages/ImageLayout.h"
+#include "HAL/Messages/ImagePool.h"
 
 #include <iostream>
 
@@ -114,13 +116,13 @@ bool ConvertDriver::Capture( hal::CameraMsg& vImages )
     // gate it here
     if (m_iChannel != -1) {
       if (m_iChannel != (int)ii) {
-        *pbImg = m_Message.image(ii);
+        pbImg->Swap(m_Message.mutable_image(ii));
         continue;
       }
     }
 
     if( m_nCvType[ii] == -1 ) { // this image cannot be converted
-      *pbImg = m_Message.image(ii);
+      pbImg->Swap(m_Message.mutable_image(ii));
       continue;
     }
 
@@ -137,14 +139,17 @@ bool ConvertDriver::Capture( hal::CameraMsg& vImages )
     pbImg->set_height( final_height );
     pbImg->set_type( hal::PB_UNSIGNED_BYTE );
     pbImg->set_format( m_nOutPbType );
-    pbImg->mutable_data()->resize(final_width * final_height *
-                                 (m_nOutCvType == CV_8UC1 ? 1 : 3) );
+    ImageBufferPool::Instance().Resize(
+        final_width * final_height * (m_nOutCvType == CV_8UC1 ? 1 : 3),
+        pbImg->mutable_data() );
 
     pbImg->set_timestamp( m_Message.image(ii).timestamp() );
     pbImg->set_serial_number( m_Message.image(ii).serial_number() );
 
+    const hal::ImageMsg& inImg = m_Message.image(ii);
     cv::Mat s_origImg(m_nOrigImgHeight[ii], m_nOrigImgWidth[ii], m_nCvType[ii],
-                   (void*)m_Message.mutable_image(ii)->data().data());
+                   (void*)(inImg.data().data() + inImg.offset()),
+                   ImageStride(inImg));
 
     cv::Mat sImg;
     if (resize_requested) {
@@ -1,5 +1,8 @@
 #include "DebayerDriver.h"
 
+#include <HAL/Messages/ImageLayout.h>
+#include <HAL/Messages/ImagePool.h>
+
 #include <iostream>
 
 namespace hal
@@ -34,14 +37,16 @@ bool DebayerDriver::Capture( hal::CameraMsg& vImages )
     if(m_Method == DC1394_BAYER_METHOD_DOWNSAMPLE) {
       pbImg->set_width( m_nImgWidth / 2 );
       pbImg->set_height( m_nImgHeight / 2 );
-      pbImg->mutable_data()->resize( 3 * m_nImgHeight * m_nImgWidth / 4);
+      ImageBufferPool::Instance().Resize( 3 * m_nImgHeight * m_nImgWidth / 4,
+                                          pbImg->mutable_data() );
     } else {
       pbImg->set_width( m_nImgWidth );
       pbImg->set_height( m_nImgHeight );
-      pbImg->mutable_data()->resize( 3 * m_nImgHeight * m_nImgWidth );
+      ImageBufferPool::Instance().Resize( 3 * m_nImgHeight * m_nImgWidth,
+                                          pbImg->mutable_data() );
     }
     pbImg->set_timestamp( m_Message.mutable_image(ii)->timestamp() );
-    pbImg->mutable_data()->resize( 3 * m_nImgHeight * m_nImgWidth );
+    PackImage( m_Message.mutable_image(ii) );
 
     if( m_nDepth == 8 ) {
       dc1394_bayer_decoding_8bit( (uint8_t*)m_Message.mutable_image(ii)->data().data(),
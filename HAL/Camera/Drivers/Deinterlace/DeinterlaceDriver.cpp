@@ -1,5 +1,7 @@
 #include "DeinterlaceDriver.h"
 
+#include <HAL/Messages/ImageLayout.h>
+
 #include <iostream>
 
 namespace hal
@@ -26,6 +28,7 @@ bool DeinterlaceDriver::Capture( hal::CameraMsg& vImages )
     }
 
     vImages.set_device_time( m_Message.device_time() );
+    PackImage( m_Message.mutable_image(0) );
 
     dc1394_deinterlace_stereo((uint8_t*)m_Message.mutable_image(0)->data().data(),
                               (uint8_t*)m_Buffer, m_nImgWidth*2, m_nImgHeight);
@@ -194,6 +194,8 @@ class PhotoCorrectionImpl : public PhotoCorrection
     {
       input.set_type(GetOutputType());
       input.set_data(buffer_.data, GetOutputMemorySize());
+      input.clear_stride();
+      input.clear_offset();
     }
 
     inline size_t GetOutputMemorySize() const
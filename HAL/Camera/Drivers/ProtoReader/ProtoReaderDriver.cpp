@@ -7,38 +7,92 @@
 #include <iomanip>
 
 namespace hal {
+
+namespace {
+
+/// Read the first frame of a camera with a reader of its own, which
+/// reads ahead as little as it can.
+bool ReadFirstFrame(const std::string& filename,
+                    const hal::ReaderOptions& options, int camId,
+                    hal::CameraMsg* pMsg, hal::Header* pHeader) {
+  hal::Reader reader(filename);
+  reader.Configure(options);
+  reader.EnableCamera(camId);
+  reader.SetMaxBufferSize(1);
+  std::shared_ptr<hal::CameraMsg> msg = reader.ReadCameraMsg(camId);
+  if( !msg ) {
+    return false;
+  }
+  pMsg->CopyFrom(*msg);
+  reader.StopBuffering();
+  *pHeader = reader.GetHeader();
+  return true;
+}
+
+}  // namespace
+
 ProtoReaderDriver::ProtoReaderDriver(std::string filename, int camID, size_t imageID,
-                                     bool realtime)
+                                     double startTime, bool realtime,
+                                     bool mmap, unsigned int decoders)
     : m_first(true),
       m_camId(camID),
       m_realtime(realtime),
-      m_reader( hal::Reader::Instance(filename,hal::Msg_Type_Camera) ) {
-  m_reader.SetInitialImage(imageID);
-  while( !ReadNextCameraMessage(m_nextMsg) ) {
+      m_reader( hal::Reader::Open(filename,hal::Msg_Type_Camera) ) {
+  // Before the first read, so that none of this camera's frames are
+  // skipped.
+  m_reader->EnableCamera(m_camId);
+  // Other drivers may read the same log already: they keep its
+  // settings.
+  hal::ReaderOptions options;
+  options.memory_mapped = mmap;
+  options.decode_threads = decoders;
+  options.start_time = startTime;
+  options.start_image = imageID;
+  m_reader->Configure(options);
+
+  // The shared reader starts reading with the first capture, once the
+  // drivers of the other cameras in the log enabled theirs too.
+  hal::CameraMsg first;
+  hal::Header pbHdr;
+  while( !ReadFirstFrame(filename, options, m_camId, &first, &pbHdr) ) {
     std::cout << "HAL: Initializing proto-reader..." << std::endl;
     usleep(100);
   }
 
-  const hal::Header pbHdr = m_reader.GetHeader();
   time_t log_date((long)pbHdr.date());
   std::cout << "- Log dated " << ctime(&log_date);
 
-  m_numChannels = m_nextMsg.image_size();
+  m_numChannels = first.image_size();
   for(size_t c=0; c < m_numChannels; ++c) {
-    m_width.push_back(m_nextMsg.image(c).width());
-    m_height.push_back(m_nextMsg.image(c).height());
+    m_width.push_back(first.image(c).width());
+    m_height.push_back(first.image(c).height());
   }
 }
 
 ProtoReaderDriver::~ProtoReaderDriver() {
-  //    m_reader.StopBuffering();
+  // The reader may be shared with drivers of other streams, or of other
+  // cameras, of the same log: let it go on without this camera.
+  m_reader->DisableCamera(m_camId);
 }
 
 bool ProtoReaderDriver::ReadNextCameraMessage(hal::CameraMsg& msg) {
   msg.Clear();
-  std::unique_ptr<hal::CameraMsg> readmsg = m_reader.ReadCameraMsg(m_camId);
+  if( m_reader->IsMemoryMapped() ) {
+    // Copies the pixels once, straight from the mapped log into the
+    // buffers msg kept from the previous frame.
+    std::unique_ptr<hal::MappedCameraMsg> mapped =
+        m_reader->ReadMappedCameraMsg(m_camId);
+    if( !mapped ) {
+      return false;
+    }
+    mapped->CopyTo(&msg);
+    return true;
+  }
+
+  std::shared_ptr<hal::CameraMsg> readmsg = m_reader->ReadCameraMsg(m_camId);
   if(readmsg) {
-    msg.Swap(readmsg.get());
+    // Swaps the image data out of the reader's arena, copies the rest.
+    hal::MoveCameraMsg(readmsg.get(), &msg);
     return true;
   }else{
     return false;
@@ -48,9 +102,9 @@ bool ProtoReaderDriver::ReadNextCameraMessage(hal::CameraMsg& msg) {
 bool ProtoReaderDriver::Capture( hal::CameraMsg& vImages ) {
   bool success = true;
   if (m_first) {
-    m_nextMsg.Swap(&vImages);
+    success = ReadNextCameraMessage(vImages);
     m_first = false;
-    if(m_realtime){
+    if(success && m_realtime){
       // start a clock with the first call to capture
       // for real-time playback of log file.
       m_start_time = std::chrono::steady_clock::now();
@@ -112,7 +166,7 @@ bool ProtoReaderDriver::Capture( hal::CameraMsg& vImages ) {
 
 std::string ProtoReaderDriver::GetDeviceProperty(const std::string& sProperty) {
   if(sProperty == hal::DeviceDirectory) {
-    return DirUp(m_reader.GetFilename());
+    return DirUp(m_reader->GetFilename());
   }
   return std::string();
 }
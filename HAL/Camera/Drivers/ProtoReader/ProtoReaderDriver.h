@@ -8,7 +8,8 @@ namespace hal {
 class ProtoReaderDriver : public CameraDriverInterface {
  public:
   ProtoReaderDriver(std::string filename, int camID, size_t imageID,
-                    bool realtime);
+                    double startTime, bool realtime, bool mmap,
+                    unsigned int decoders = 0);
   ~ProtoReaderDriver();
 
   bool Capture( hal::CameraMsg& vImages );
@@ -29,8 +30,7 @@ class ProtoReaderDriver : public CameraDriverInterface {
   bool                    m_first;
   bool                    m_realtime;
   int                     m_camId;
-  hal::Reader&             m_reader;
-  hal::CameraMsg           m_nextMsg;
+  std::shared_ptr<hal::Reader> m_reader;
 
   std::vector<size_t>     m_width;
   std::vector<size_t>     m_height;
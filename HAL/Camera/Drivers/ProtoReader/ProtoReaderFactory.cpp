@@ -12,8 +12,11 @@ public:
     {
         Params() = {
             {"startframe", "0", "First frame to capture."},
+            {"starttime", "0", "Seconds into the log to start capturing at."},
             {"id", "0", "Id of the camera in log."},
-            {"realtime", "0", "If the data should be played back at framerate"}
+            {"realtime", "0", "If the data should be played back at framerate"},
+            {"mmap", "0", "Read the log through a memory mapping, copying images once."},
+            {"decoders", "0", "Threads parsing the log, 0 parses on the read thread."}
         };
     }
 
@@ -21,11 +24,15 @@ public:
     {
         const std::string file = ExpandTildePath(uri.url);
         size_t startframe  = uri.properties.Get("startframe", 0);
+        double starttime = uri.properties.Get("starttime", 0.0);
         int camId = uri.properties.Get("id", -1);
         bool realtime = uri.properties.Get("realtime", 0);
+        bool mmap = uri.properties.Get("mmap", 0);
+        unsigned int decoders = uri.properties.Get("decoders", 0);
 
         ProtoReaderDriver* driver =
-            new ProtoReaderDriver(file, camId, startframe, realtime);
+            new ProtoReaderDriver(file, camId, startframe, starttime, realtime,
+                                  mmap, decoders);
         return std::shared_ptr<CameraDriverInterface>( driver );
     }
 };
@@ -0,0 +1,170 @@
+#include "PyramidDriver.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+#include <HAL/Messages/HalfSample.h>
+#include <HAL/Messages/ImageCodec.h>
+#include <HAL/Messages/ImageLayout.h>
+#include <HAL/Messages/ImagePool.h>
+
+namespace hal
+{
+
+namespace
+{
+
+unsigned int NumThreads(unsigned int nThreads, size_t nChannels)
+{
+    if (nThreads == 0) {
+        nThreads = std::max<unsigned int>(
+            1, std::min<unsigned int>(nChannels,
+                                      std::thread::hardware_concurrency()));
+    }
+    return nThreads;
+}
+
+/// Halve `src` into `pDst`, which already has its size and type set.
+bool HalfSampleImage(const hal::ImageMsg& src, hal::ImageMsg* pDst)
+{
+    const unsigned char* pSrc =
+            reinterpret_cast<const unsigned char*>(src.data().data()) +
+            src.offset();
+    const size_t nChannels = ImageChannels(src);
+    ImageBufferPool::Instance().Resize(
+            pDst->height() * ImageRowBytes(*pDst), pDst->mutable_data());
+    unsigned char* pOut =
+            reinterpret_cast<unsigned char*>(&(*pDst->mutable_data())[0]);
+
+    // Signed bytes would need a kernel of their own.
+    switch (src.type()) {
+    case hal::PB_UNSIGNED_BYTE:
+        HalfSample(pSrc, ImageStride(src), src.width(), src.height(),
+                   nChannels, pOut, ImageRowBytes(*pDst));
+        return true;
+    case hal::PB_UNSIGNED_SHORT:
+        HalfSample(reinterpret_cast<const uint16_t*>(pSrc), ImageStride(src),
+                   src.width(), src.height(), nChannels,
+                   reinterpret_cast<uint16_t*>(pOut), ImageRowBytes(*pDst));
+        return true;
+    case hal::PB_FLOAT:
+        HalfSample(reinterpret_cast<const float*>(pSrc), ImageStride(src),
+                   src.width(), src.height(), nChannels,
+                   reinterpret_cast<float*>(pOut), ImageRowBytes(*pDst));
+        return true;
+    default:
+        return false;
+    }
+}
+
+}
+
+PyramidDriver::PyramidDriver(std::shared_ptr<CameraDriverInterface> Input,
+                             unsigned int nLevels, unsigned int nThreads)
+    : m_Input(Input),
+      m_nLevels(std::max(1u, nLevels)),
+      m_nInChannels(Input->NumChannels()),
+      m_Workers(NumThreads(nThreads, Input->NumChannels()))
+{
+}
+
+bool PyramidDriver::BuildLevels(
+        hal::ImageMsg* pImage,
+        const std::vector<hal::ImageMsg*>& vLevels,
+        std::string* pError) const
+{
+    // Levels are made of pixels: decode an encoded input.
+    if (!DecodeImage(pImage)) {
+        *pError = "its " + hal::ImageCodec_Name(pImage->codec()) +
+                  " data could not be decoded";
+        return false;
+    }
+    if (!HasImageLayout(*pImage)) {
+        *pError = "its layout is unknown";
+        return false;
+    }
+
+    const hal::ImageMsg* pSrc = pImage;
+    for (size_t ii = 0; ii < vLevels.size(); ++ii) {
+        hal::ImageMsg* pLevel = vLevels[ii];
+        pLevel->set_width(pSrc->width() / 2);
+        pLevel->set_height(pSrc->height() / 2);
+        pLevel->set_type(pSrc->type());
+        // 2x2 blocks of a Bayer pattern average to grey.
+        pLevel->set_format(pSrc->format() == hal::PB_RAW ?
+                           hal::PB_LUMINANCE : pSrc->format());
+        pLevel->set_timestamp(pImage->timestamp());
+        pLevel->set_serial_number(pImage->serial_number());
+        pLevel->set_pyramid_level(ii + 1);
+        if (pImage->has_info()) {
+            *pLevel->mutable_info() = pImage->info();
+        }
+        if (!HalfSampleImage(*pSrc, pLevel)) {
+            *pError = "only unsigned 8-bit, 16-bit and float images are "
+                      "halved, not " + hal::Type_Name(pSrc->type());
+            return false;
+        }
+        pSrc = pLevel;
+    }
+    return true;
+}
+
+bool PyramidDriver::Capture( hal::CameraMsg& vImages )
+{
+    if( !m_Input->Capture( vImages ) ) {
+        return false;
+    }
+
+    // Add every level up front: the channels are then built in
+    // parallel without touching the message itself.
+    const int nInImages = vImages.image_size();
+    std::vector<std::vector<hal::ImageMsg*>> vLevels(nInImages);
+    for( unsigned int level = 1; level < m_nLevels; ++level ) {
+        for( int ii = 0; ii < nInImages; ++ii ) {
+            vLevels[ii].push_back( vImages.add_image() );
+        }
+    }
+
+    // One slot per image, so that the workers don't share one.
+    std::vector<std::string> vErrors(nInImages);
+    m_Workers.Run(nInImages, [&](size_t ii) {
+        BuildLevels( vImages.mutable_image(ii), vLevels[ii], &vErrors[ii] );
+    });
+    for( int ii = 0; ii < nInImages; ++ii ) {
+        if( !vErrors[ii].empty() ) {
+            std::cerr << "HAL: Error! Pyramid can't build the levels of image "
+                      << ii << ": " << vErrors[ii] << "." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string PyramidDriver::GetDeviceProperty(const std::string& sProperty)
+{
+    return m_Input->GetDeviceProperty(sProperty);
+}
+
+size_t PyramidDriver::NumChannels() const
+{
+    return m_nInChannels * m_nLevels;
+}
+
+size_t PyramidDriver::Width( size_t idx ) const
+{
+    if( m_nInChannels == 0 ) {
+        return 0;
+    }
+    return m_Input->Width( idx % m_nInChannels ) >> (idx / m_nInChannels);
+}
+
+size_t PyramidDriver::Height( size_t idx ) const
+{
+    if( m_nInChannels == 0 ) {
+        return 0;
+    }
+    return m_Input->Height( idx % m_nInChannels ) >> (idx / m_nInChannels);
+}
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <HAL/Camera.pb.h>
+#include <HAL/Utils/WorkerPool.h>
+#include "HAL/Camera/CameraDriverInterface.h"
+
+
+namespace hal
+{
+
+/**
+ * Adds the levels of an image pyramid of every channel of the input to
+ * its frames, halving each level into the next with hal::HalfSample().
+ *
+ * The N input channels come first, unchanged, followed by level 1 of
+ * each channel, then level 2 and so on: channel `c` of level `l` is
+ * channel l * N + c, and carries its level in ImageMsg.pyramid_level.
+ * hal::ImagePyramid::Build() picks the levels up instead of computing
+ * them again, so every consumer of a frame shares the work.
+ *
+ * The channels are built in parallel; level data comes from the
+ * ImageBufferPool.
+ */
+class PyramidDriver : public CameraDriverInterface
+{
+public:
+    /// `nLevels` levels in all, counting the input images.
+    PyramidDriver(std::shared_ptr<CameraDriverInterface> Input,
+                  unsigned int nLevels, unsigned int nThreads);
+
+    bool Capture( hal::CameraMsg& vImages );
+    std::shared_ptr<CameraDriverInterface> GetInputDevice() { return m_Input; }
+
+    std::string GetDeviceProperty(const std::string& sProperty);
+
+    size_t NumChannels() const;
+    size_t Width( size_t idx = 0 ) const;
+    size_t Height( size_t idx = 0 ) const;
+
+protected:
+    /// Fill in the levels of an image, from `vLevels[0]` on. Returns
+    /// false and says why in `pError` if the image can't be halved.
+    bool BuildLevels(hal::ImageMsg* pImage,
+                     const std::vector<hal::ImageMsg*>& vLevels,
+                     std::string* pError) const;
+
+    std::shared_ptr<CameraDriverInterface>  m_Input;
+    unsigned int                            m_nLevels;
+    size_t                                  m_nInChannels;
+    WorkerPool                              m_Workers;
+};
+
+}
@@ -0,0 +1,36 @@
+#include <HAL/Devices/DeviceFactory.h>
+#include "PyramidDriver.h"
+
+namespace hal
+{
+
+class PyramidFactory : public DeviceFactory<CameraDriverInterface>
+{
+public:
+    PyramidFactory(const std::string& name)
+        : DeviceFactory<CameraDriverInterface>(name)
+    {
+        Params() = {
+            {"levels", "4", "Pyramid levels, counting the input images."},
+            {"threads", "0", "Threads building levels (0 for one per channel)."}
+        };
+    }
+
+    std::shared_ptr<CameraDriverInterface> GetDevice(const Uri& uri)
+    {
+        // Create input camera
+        std::shared_ptr<CameraDriverInterface> Input =
+                DeviceRegistry<hal::CameraDriverInterface>::Instance().Create(
+                    Uri(uri.url));
+
+        PyramidDriver* pDriver = new PyramidDriver( Input,
+                uri.properties.Get<unsigned int>("levels", 4),
+                uri.properties.Get<unsigned int>("threads", 0) );
+        return std::shared_ptr<CameraDriverInterface>( pDriver );
+    }
+};
+
+// Register this factory by creating static instance of factory
+static PyramidFactory g_PyramidFactory("pyramid");
+
+}
@@ -1,6 +1,8 @@
 #include "RectifyDriver.h"
 
 #include <HAL/Messages/Image.h>
+#include <HAL/Messages/ImageLayout.h>
+#include <HAL/Messages/ImagePool.h>
 
 namespace hal
 {
@@ -37,18 +39,21 @@ RectifyDriver::RectifyDriver(std::shared_ptr<CameraDriverInterface> input,
 
 bool RectifyDriver::Capture( hal::CameraMsg& vImages )
 {
-  hal::CameraMsg vIn;
+  m_InMsg.Clear();
 
-  const bool success = m_input->Capture( vIn );
+  const bool success = m_input->Capture( m_InMsg );
 
   if(success) {
     vImages.Clear();
 
-    hal::Image inimg[2] = { hal::Image(vIn.image(0)),
-                           hal::Image(vIn.image(1)) };
+    // The lookup tables address packed pixels.
+    PackImage(m_InMsg.mutable_image(0));
+    PackImage(m_InMsg.mutable_image(1));
+    hal::Image inimg[2] = { hal::Image(m_InMsg.image(0)),
+                           hal::Image(m_InMsg.image(1)) };
 
-    vImages.set_system_time(vIn.system_time());
-    vImages.set_device_time(vIn.device_time());
+    vImages.set_system_time(m_InMsg.system_time());
+    vImages.set_device_time(m_InMsg.device_time());
 
     for(int k=0; k < 2; ++k) {
       uint num_channels = 1;
@@ -66,8 +71,9 @@ bool RectifyDriver::Capture( hal::CameraMsg& vImages )
       pimg->set_timestamp(inimg[k].Timestamp());
       pimg->set_type( (hal::Type)inimg[k].Type());
       pimg->set_format( (hal::Format)inimg[k].Format());
-      pimg->mutable_data()->resize(inimg[k].Width() * inimg[k].Height() *
-                                   num_channels);
+      ImageBufferPool::Instance().Resize(
+            inimg[k].Width() * inimg[k].Height() * num_channels,
+            pimg->mutable_data());
 
       hal::Image img = hal::Image(*pimg);
       calibu::Rectify(
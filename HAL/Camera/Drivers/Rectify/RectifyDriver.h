@@ -42,6 +42,7 @@ protected:
     Sophus::SE3d                                       m_T_nr_nl;
     std::shared_ptr<calibu::Rig<double>>               m_rig;
     std::shared_ptr<CameraDriverInterface>             m_input;
+    hal::CameraMsg                                     m_InMsg;
     std::vector<calibu::LookupTable>                   m_vLuts;
 
 };
@@ -1,5 +1,12 @@
 #include "SplitDriver.h"
 
+#include <HAL/Messages/ImageLayout.h>
+#include <HAL/Messages/ImagePool.h>
+
+#include <string.h>
+
+#include <iostream>
+
 namespace hal
 {
 
@@ -21,42 +28,64 @@ bool SplitDriver::Capture( hal::CameraMsg& vImages )
         return false;
     }
 
-    const hal::ImageMsg& InImg = m_InMsg.image(0);
+    hal::ImageMsg* pInImg = m_InMsg.mutable_image(0);
+    const size_t nBytesPerPixel = ImageBytesPerPixel( *pInImg );
+    const size_t nInStride = ImageStride( *pInImg );
+
+    if( nBytesPerPixel == 0 || !HasImageLayout( *pInImg ) ) {
+        std::cerr << "error: Split got an image of unknown layout." << std::endl;
+        return false;
+    }
 
     for( unsigned int ii = 0; ii < m_vROIs.size(); ++ii ) {
+        const ImageRoi& ROI = m_vROIs[ii];
+        if( ROI.x + ROI.w > pInImg->width() || ROI.y + ROI.h > pInImg->height() ) {
+            std::cerr << "error: Split ROI " << ii + 1 << " is outside the "
+                      << pInImg->width() << "x" << pInImg->height() << " image." << std::endl;
+            return false;
+        }
+    }
 
-        hal::ImageMsg* pImg = vImages.add_image();
+    vImages.set_device_time( m_InMsg.device_time() );
+    vImages.set_system_time( m_InMsg.system_time() );
 
-        pImg->set_format( InImg.format() );
-        pImg->set_type( InImg.type() );
-        pImg->set_timestamp( InImg.timestamp() );
-
-        const unsigned int nChannels = InImg.format() == hal::PB_LUMINANCE ? 1 : 3;
-        unsigned int nDepth = 1;
-        if( InImg.type() == hal::PB_SHORT || InImg.type() == hal::PB_UNSIGNED_SHORT ) {
-            nDepth = 2;
-        } else if( InImg.type() == hal::PB_INT || InImg.type() == hal::PB_UNSIGNED_INT ) {
-            nDepth = 4;
-        } else if( InImg.type() == hal::PB_FLOAT ) {
-            nDepth = 4;
-        } else if( InImg.type() == hal::PB_DOUBLE ) {
-            nDepth = 8;
-        }
+    for( unsigned int ii = 0; ii < m_vROIs.size(); ++ii ) {
+
+        hal::ImageMsg* pImg = vImages.add_image();
 
-        const unsigned int nBytesPerPixel = nChannels * nDepth;
+        pImg->set_format( pInImg->format() );
+        pImg->set_type( pInImg->type() );
+        pImg->set_timestamp( pInImg->timestamp() );
 
         const ImageRoi& ROI = m_vROIs[ii];
-        const unsigned int nBytesPerRow = ROI.w * nBytesPerPixel;
+        const size_t nBytesPerRow = ROI.w * nBytesPerPixel;
+        const size_t nOffset = pInImg->offset() + ROI.y * nInStride +
+                               ROI.x * nBytesPerPixel;
 
         pImg->set_width( ROI.w );
         pImg->set_height( ROI.h );
-        pImg->mutable_data()->resize( ROI.h * nBytesPerRow );
 
-        unsigned char* pS = (unsigned char*)&InImg.data().front();
+        // The last ROI needs no copy: it is a view of the input buffer,
+        // which is not needed any more.
+        if( ii + 1 == m_vROIs.size() ) {
+            pImg->mutable_data()->swap( *pInImg->mutable_data() );
+            pImg->set_offset( nOffset );
+            pImg->set_stride( nInStride );
+            if( IsPackedImage( *pImg ) ) {
+                pImg->clear_offset();
+                pImg->clear_stride();
+            }
+            break;
+        }
+
+        ImageBufferPool::Instance().Resize( ROI.h * nBytesPerRow, pImg->mutable_data() );
+
+        const unsigned char* pS = (const unsigned char*)pInImg->data().data() + nOffset;
         unsigned char* pD = (unsigned char*)&pImg->mutable_data()->front();
-        for( unsigned int ii = 0; ii < ROI.h; ++ii ) {
-            memcpy( pD, pS + (InImg.width()*(ii+ROI.y)) + ROI.x, nBytesPerRow);
-            pD = pD + ROI.w;
+        for( unsigned int row = 0; row < ROI.h; ++row ) {
+            memcpy( pD, pS, nBytesPerRow );
+            pS += nInStride;
+            pD += nBytesPerRow;
         }
     }
 
@@ -1,6 +1,8 @@
 #include "UndistortDriver.h"
 
 #include <HAL/Messages/Image.h>
+#include <HAL/Messages/ImageLayout.h>
+#include <HAL/Messages/ImagePool.h>
 
 namespace hal
 {
@@ -52,7 +54,8 @@ bool UndistortDriver::Capture( hal::CameraMsg& vImages )
   
   if(success) {
     for (int ii = 0; ii < m_InMsg.image_size(); ++ii) {
-  
+      // The lookup tables address packed pixels.
+      PackImage(m_InMsg.mutable_image(ii));
       hal::Image inimg = hal::Image(m_InMsg.image(ii));
       hal::ImageMsg* pimg = vImages.add_image();
       pimg->set_width(inimg.Width());
@@ -77,15 +80,17 @@ bool UndistortDriver::Capture( hal::CameraMsg& vImages )
       hal::Image img = hal::Image(*pimg);
 
       if (pimg->type() == hal::PB_UNSIGNED_BYTE) {
-        pimg->mutable_data()->resize(inimg.Width() * inimg.Height() *
-                                     sizeof(unsigned char) * num_channels);
+        ImageBufferPool::Instance().Resize(
+              inimg.Width() * inimg.Height() * sizeof(unsigned char) *
+              num_channels, pimg->mutable_data());
         calibu::Rectify<unsigned char>(
               m_vLuts[ii], inimg.data(),
               reinterpret_cast<unsigned char*>(&pimg->mutable_data()->front()),
               img.Width(), img.Height(), num_channels);
       } else if (pimg->type() == hal::PB_FLOAT) {
-        pimg->mutable_data()->resize(inimg.Width() * inimg.Height() *
-                                     sizeof(float) * num_channels);
+        ImageBufferPool::Instance().Resize(
+              inimg.Width() * inimg.Height() * sizeof(float) * num_channels,
+              pimg->mutable_data());
         calibu::Rectify<float>(
               m_vLuts[ii], (float*)inimg.data(),
               reinterpret_cast<float*>(&pimg->mutable_data()->front()),
@@ -5,7 +5,7 @@ using namespace hal;
 
 /////////////////////////////////////////////////////////////////////////////////////////
 ProtoReaderIMUDriver::ProtoReaderIMUDriver(std::string filename)
-    : m_reader(hal::Reader::Instance(filename,hal::Msg_Type_IMU)), m_running(false), m_callback(nullptr)
+    : m_reader(hal::Reader::Open(filename,hal::Msg_Type_IMU)), m_running(false), m_callback(nullptr)
 {
 }
 
@@ -14,7 +14,7 @@ ProtoReaderIMUDriver::ProtoReaderIMUDriver(std::string filename)
 void ProtoReaderIMUDriver::_ThreadFunc()
 {
   while( m_running ) {
-    if (std::unique_ptr<hal::ImuMsg> readmsg = m_reader.ReadImuMsg()) {
+    if (std::shared_ptr<hal::ImuMsg> readmsg = m_reader->ReadImuMsg()) {
       m_callback( *readmsg );
     } else {
       // Notify that this file has finished
@@ -32,7 +32,8 @@ void ProtoReaderIMUDriver::_ThreadFunc()
 ProtoReaderIMUDriver::~ProtoReaderIMUDriver()
 {
     m_running = false;
-    m_reader.StopBuffering();
+    // Ends the read on our thread; other drivers may share the reader.
+    m_reader->Disable(hal::Msg_Type_IMU);
     if( m_callbackThread.joinable() ) {
         m_callbackThread.join();
     }
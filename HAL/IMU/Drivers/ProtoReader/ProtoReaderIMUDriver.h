@@ -22,7 +22,7 @@ private:
     void _ThreadFunc();
 
 private:
-    hal::Reader&             m_reader;
+    std::shared_ptr<hal::Reader> m_reader;
     bool                    m_running;
     std::thread             m_callbackThread;
     IMUDriverDataCallback   m_callback;
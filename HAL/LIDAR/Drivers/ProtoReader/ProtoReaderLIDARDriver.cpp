@@ -5,7 +5,7 @@ using namespace hal;
 
 /////////////////////////////////////////////////////////////////////////////////////////
 ProtoReaderLIDARDriver::ProtoReaderLIDARDriver(std::string filename)
-    : m_reader(hal::Reader::Instance(filename, hal::Msg_Type_LIDAR)), m_running(false), m_callback(nullptr)
+    : m_reader(hal::Reader::Open(filename, hal::Msg_Type_LIDAR)), m_running(false), m_callback(nullptr)
 {
 }
 
@@ -14,7 +14,7 @@ ProtoReaderLIDARDriver::ProtoReaderLIDARDriver(std::string filename)
 void ProtoReaderLIDARDriver::_ThreadFunc()
 {
     while( m_running ) {
-        std::unique_ptr<hal::LidarMsg> readmsg = m_reader.ReadLidarMsg();
+        std::shared_ptr<hal::LidarMsg> readmsg = m_reader->ReadLidarMsg();
         if(readmsg) {
             m_callback( *readmsg );
         } else {
@@ -27,7 +27,8 @@ void ProtoReaderLIDARDriver::_ThreadFunc()
 ProtoReaderLIDARDriver::~ProtoReaderLIDARDriver()
 {
     m_running = false;
-    m_reader.StopBuffering();
+    // Ends the read on our thread; other drivers may share the reader.
+    m_reader->Disable(hal::Msg_Type_LIDAR);
     if( m_callbackThread.joinable() ) {
         m_callbackThread.join();
     }
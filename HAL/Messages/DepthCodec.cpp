@@ -0,0 +1,266 @@
+#include <HAL/Messages/DepthCodec.h>
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace hal {
+
+namespace {
+
+// Every number is written as 3-bit groups, least significant first, in
+// nibbles whose high bit is set while more groups follow. Nibbles fill
+// 32-bit little endian words from their most significant end.
+
+class NibbleWriter {
+ public:
+  explicit NibbleWriter(std::string* out)
+      : out_(out), size_(out->size()), word_(0), count_(0) {}
+
+  void Write(uint32_t value) {
+    // Most numbers fit a single nibble: deltas within a surface.
+    if (value < 8) {
+      Put(value);
+      return;
+    }
+    do {
+      uint32_t nibble = value & 0x7;
+      value >>= 3;
+      if (value) {
+        nibble |= 0x8;
+      }
+      Put(nibble);
+    } while (value);
+  }
+
+  void Finish() {
+    if (count_ > 0) {
+      word_ <<= 4 * (8 - count_);
+      Flush();
+    }
+    out_->resize(size_);
+  }
+
+ private:
+  void Put(uint32_t nibble) {
+    word_ = (word_ << 4) | nibble;
+    if (++count_ == 8) {
+      Flush();
+    }
+  }
+
+  void Flush() {
+    // Grow geometrically rather than appending a word at a time.
+    if (out_->size() - size_ < 4) {
+      out_->resize(std::max<size_t>(2 * out_->size(), 1 << 12));
+    }
+    unsigned char* p = reinterpret_cast<unsigned char*>(&(*out_)[size_]);
+    p[0] = static_cast<unsigned char>(word_);
+    p[1] = static_cast<unsigned char>(word_ >> 8);
+    p[2] = static_cast<unsigned char>(word_ >> 16);
+    p[3] = static_cast<unsigned char>(word_ >> 24);
+    size_ += 4;
+    word_ = 0;
+    count_ = 0;
+  }
+
+  std::string* out_;
+  size_t       size_;  // Bytes of out_ in use.
+  uint32_t     word_;
+  int          count_;
+};
+
+/// What a byte of coded data, two nibbles, does to the number being
+/// decoded. Decoding a byte at a time through this table takes no
+/// branches, whichever of its nibbles end a number.
+struct NibblePair {
+  uint8_t group;   // 3-bit groups up to the first end, or of both nibbles.
+  uint8_t second;  // Second number, if both nibbles end one.
+  uint8_t ends;    // Numbers ended by the byte.
+  uint8_t keep;    // 0xff if the number carries on past the byte.
+  uint8_t carry;   // Start of the next number, after one ended.
+  uint8_t shift;   // Bits of the next number, after one ended, or added.
+  uint8_t reach;   // Bits added before the number ends, 0 if it ended.
+};
+
+class NibbleTable {
+ public:
+  NibbleTable() {
+    for (int byte = 0; byte < 256; ++byte) {
+      const int high = byte >> 4;
+      const int low = byte & 0xf;
+      const bool high_ends = !(high & 0x8);
+      const bool low_ends = !(low & 0x8);
+      NibblePair& pair = pairs_[byte];
+      pair.second = low & 0x7;
+      if (high_ends) {
+        pair.group = high & 0x7;
+        pair.ends = low_ends ? 2 : 1;
+        pair.keep = 0;
+        pair.carry = low_ends ? 0 : low & 0x7;
+        pair.shift = low_ends ? 0 : 3;
+        pair.reach = 0;
+      } else {
+        pair.group = (high & 0x7) | ((low & 0x7) << 3);
+        pair.ends = low_ends ? 1 : 0;
+        pair.keep = low_ends ? 0 : 0xff;
+        pair.carry = 0;
+        pair.shift = low_ends ? 0 : 6;
+        pair.reach = low_ends ? 3 : 6;
+      }
+    }
+  }
+
+  const NibblePair& operator[](unsigned char byte) const {
+    return pairs_[byte];
+  }
+
+ private:
+  NibblePair pairs_[256];
+};
+
+const NibbleTable kNibbleTable;
+
+/// Decodes the numbers of a block of words ahead of the pixels, so
+/// runs of pixels can be filled in a tight loop.
+class NibbleReader {
+ public:
+  NibbleReader(const unsigned char* data, size_t size)
+      : data_(data), end_(data + size - size % 4), value_(0), shift_(0),
+        next_(0), count_(0), failed_(false) {}
+
+  /// Up to `max` numbers, returned in `values`. 0 at the end of the data.
+  size_t Take(size_t max, const uint32_t** values) {
+    if (next_ == count_ && !Fill()) {
+      return 0;
+    }
+    const size_t n = std::min(max, count_ - next_);
+    *values = numbers_ + next_;
+    next_ += n;
+    return n;
+  }
+
+  bool Read(uint32_t* value) {
+    const uint32_t* values;
+    if (!Take(1, &values)) {
+      return false;
+    }
+    *value = *values;
+    return true;
+  }
+
+ private:
+  static const size_t kBlockWords = 64;
+
+  bool Fill() {
+    next_ = 0;
+    count_ = 0;
+    while (count_ == 0 && !failed_ && data_ != end_) {
+      const unsigned char* block_end =
+          data_ + std::min<size_t>(4 * kBlockWords, end_ - data_);
+      uint64_t value = value_;
+      uint32_t shift = shift_;
+      size_t count = 0;
+      for (; data_ != block_end; data_ += 4) {
+        // Nibbles fill a little endian word from its top.
+        for (int ii = 3; ii >= 0; --ii) {
+          const NibblePair& pair = kNibbleTable[data_[ii]];
+          // Numbers are at most 32 bits, 11 groups.
+          if (shift + pair.reach > 30) {
+            failed_ = true;
+            count_ = count;
+            return count_ > 0;
+          }
+          const uint64_t number = value | (uint64_t(pair.group) << shift);
+          numbers_[count] = static_cast<uint32_t>(number);
+          numbers_[count + 1] = pair.second;
+          count += pair.ends;
+
+          const uint64_t keep = pair.keep ? ~0ull : 0;
+          value = (number & keep) | pair.carry;
+          shift = (shift & static_cast<uint32_t>(keep)) + pair.shift;
+        }
+      }
+      value_ = value;
+      shift_ = shift;
+      count_ = count;
+    }
+    return count_ > 0;
+  }
+
+  const unsigned char* data_;
+  const unsigned char* end_;
+  uint64_t             value_;  // Number carried over to the next block.
+  uint32_t             shift_;
+  size_t               next_;
+  size_t               count_;
+  bool                 failed_;
+  uint32_t             numbers_[8 * kBlockWords + 1];
+};
+
+}  // namespace
+
+void EncodeDepth16(const uint16_t* pPixels, size_t nCount,
+                   std::string* out) {
+  NibbleWriter writer(out);
+  const uint16_t* end = pPixels + nCount;
+  int previous = 0;
+  while (pPixels < end) {
+    const uint16_t* run = pPixels;
+    while (pPixels < end && *pPixels == 0) {
+      ++pPixels;
+    }
+    writer.Write(static_cast<uint32_t>(pPixels - run));
+
+    run = pPixels;
+    while (run < end && *run != 0) {
+      ++run;
+    }
+    writer.Write(static_cast<uint32_t>(run - pPixels));
+
+    for (; pPixels < run; ++pPixels) {
+      const int current = *pPixels;
+      const int delta = current - previous;
+      writer.Write((static_cast<uint32_t>(delta) << 1) ^
+                   static_cast<uint32_t>(delta >> 31));
+      previous = current;
+    }
+  }
+  writer.Finish();
+}
+
+bool DecodeDepth16(const unsigned char* pData, size_t nSize,
+                   uint16_t* pPixels, size_t nCount) {
+  NibbleReader reader(pData, nSize);
+  uint16_t* end = pPixels + nCount;
+  int current = 0;
+  while (pPixels < end) {
+    uint32_t zeros, nonzeros;
+    if (!reader.Read(&zeros) || zeros > static_cast<size_t>(end - pPixels)) {
+      return false;
+    }
+    memset(pPixels, 0, zeros * sizeof(*pPixels));
+    pPixels += zeros;
+
+    if (!reader.Read(&nonzeros) ||
+        nonzeros > static_cast<size_t>(end - pPixels)) {
+      return false;
+    }
+    for (uint16_t* run = pPixels + nonzeros; pPixels < run; ) {
+      const uint32_t* positive;
+      const size_t n = reader.Take(run - pPixels, &positive);
+      if (n == 0) {
+        return false;
+      }
+      for (size_t ii = 0; ii < n; ++ii) {
+        current += static_cast<int>(positive[ii] >> 1) ^
+            -static_cast<int>(positive[ii] & 1);
+        pPixels[ii] = static_cast<uint16_t>(current);
+      }
+      pPixels += n;
+    }
+  }
+  return true;
+}
+
+}  // namespace hal
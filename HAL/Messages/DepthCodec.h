@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+namespace hal {
+
+/**
+ * Lossless coding of 16-bit depth images, the PB_CODEC_DEPTH16 codec.
+ *
+ * Run length / variable length coding (A. Wilson, "Fast Lossless Depth
+ * Image Compression", 2017): runs of zero (invalid) pixels alternate
+ * with runs of valid pixels, which are stored as zigzag coded deltas in
+ * 3-bit groups. Depth of smooth surfaces shrinks by 3-4x, and both
+ * directions run at several hundred MB/s or more a core, fast enough to
+ * keep up with live depth streams.
+ *
+ * Most code goes through hal::EncodeImage() and hal::DecodeImage(); use
+ * these directly on pixel buffers which are not in an ImageMsg.
+ */
+
+/// Append the coded pixels to `out`.
+void EncodeDepth16(const uint16_t* pPixels, size_t nCount, std::string* out);
+
+/// Decode exactly `nCount` pixels. Returns false if the data is corrupt
+/// or holds fewer pixels.
+bool DecodeDepth16(const unsigned char* pData, size_t nSize,
+                   uint16_t* pPixels, size_t nCount);
+
+}  // namespace hal
@@ -0,0 +1,174 @@
+#include <HAL/Messages/HalfSample.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HAL_HALF_SAMPLE_NEON
+#endif
+
+namespace hal {
+
+namespace {
+
+template <typename T>
+T Average4(T a, T b, T c, T d);
+
+template <>
+inline uint8_t Average4(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+  return static_cast<uint8_t>((a + b + c + d + 2) >> 2);
+}
+
+template <>
+inline uint16_t Average4(uint16_t a, uint16_t b, uint16_t c, uint16_t d) {
+  return static_cast<uint16_t>((uint32_t(a) + b + c + d + 2) >> 2);
+}
+
+template <>
+inline float Average4(float a, float b, float c, float d) {
+  return 0.25f * ((a + b) + (c + d));
+}
+
+template <typename T>
+const T* Row(const T* p, size_t nStride, size_t row) {
+  return reinterpret_cast<const T*>(
+      reinterpret_cast<const char*>(p) + row * nStride);
+}
+
+template <typename T>
+T* Row(T* p, size_t nStride, size_t row) {
+  return reinterpret_cast<T*>(reinterpret_cast<char*>(p) + row * nStride);
+}
+
+/// Pixels [x0, nOutWidth) of an output row.
+template <typename T>
+void HalfSampleRow(const T* r0, const T* r1, size_t x0, size_t nOutWidth,
+                   size_t nChannels, T* d) {
+  for (size_t x = x0; x < nOutWidth; ++x) {
+    const size_t s = 2 * x * nChannels;
+    for (size_t c = 0; c < nChannels; ++c) {
+      d[x * nChannels + c] = Average4<T>(r0[s + c], r0[s + nChannels + c],
+                                         r1[s + c], r1[s + nChannels + c]);
+    }
+  }
+}
+
+/// Output pixels of a single channel 8-bit row done with SIMD, returns
+/// how many. Each 16-bit lane holds a horizontal pair of input pixels:
+/// masking and shifting separate them, so sums are exact and rounding
+/// matches the scalar code.
+size_t HalfSampleGreyRow(const uint8_t* r0, const uint8_t* r1,
+                         size_t nOutWidth, uint8_t* d) {
+  size_t x = 0;
+#if defined(__AVX2__)
+  {
+    const __m256i mask = _mm256_set1_epi16(0x00ff);
+    const __m256i two = _mm256_set1_epi16(2);
+    for (; x + 32 <= nOutWidth; x += 32) {
+      __m256i sums[2];
+      for (int half = 0; half < 2; ++half) {
+        const __m256i a = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(r0 + 2 * x + 32 * half));
+        const __m256i b = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(r1 + 2 * x + 32 * half));
+        const __m256i even = _mm256_add_epi16(_mm256_and_si256(a, mask),
+                                              _mm256_and_si256(b, mask));
+        const __m256i odd = _mm256_add_epi16(_mm256_srli_epi16(a, 8),
+                                             _mm256_srli_epi16(b, 8));
+        sums[half] = _mm256_srli_epi16(
+            _mm256_add_epi16(_mm256_add_epi16(even, odd), two), 2);
+      }
+      // Packing works within 128-bit lanes: put the quarters in order.
+      const __m256i packed = _mm256_permute4x64_epi64(
+          _mm256_packus_epi16(sums[0], sums[1]), 0xd8);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + x), packed);
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  {
+    const __m128i mask = _mm_set1_epi16(0x00ff);
+    const __m128i two = _mm_set1_epi16(2);
+    for (; x + 16 <= nOutWidth; x += 16) {
+      __m128i sums[2];
+      for (int half = 0; half < 2; ++half) {
+        const __m128i a = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(r0 + 2 * x + 16 * half));
+        const __m128i b = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(r1 + 2 * x + 16 * half));
+        const __m128i even = _mm_add_epi16(_mm_and_si128(a, mask),
+                                           _mm_and_si128(b, mask));
+        const __m128i odd = _mm_add_epi16(_mm_srli_epi16(a, 8),
+                                          _mm_srli_epi16(b, 8));
+        sums[half] = _mm_srli_epi16(
+            _mm_add_epi16(_mm_add_epi16(even, odd), two), 2);
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(d + x),
+                       _mm_packus_epi16(sums[0], sums[1]));
+    }
+  }
+#elif defined(HAL_HALF_SAMPLE_NEON)
+  for (; x + 8 <= nOutWidth; x += 8) {
+    const uint16x8_t sum = vaddq_u16(vpaddlq_u8(vld1q_u8(r0 + 2 * x)),
+                                     vpaddlq_u8(vld1q_u8(r1 + 2 * x)));
+    vst1_u8(d + x, vrshrn_n_u16(sum, 2));
+  }
+#endif
+  (void)r0;
+  (void)r1;
+  (void)nOutWidth;
+  (void)d;
+  return x;
+}
+
+template <typename T>
+void HalfSampleImage(const T* pSrc, size_t nSrcStride, size_t nWidth,
+                     size_t nHeight, size_t nChannels, T* pDst,
+                     size_t nDstStride) {
+  const size_t nOutWidth = nWidth / 2;
+  for (size_t y = 0; y < nHeight / 2; ++y) {
+    HalfSampleRow(Row(pSrc, nSrcStride, 2 * y),
+                  Row(pSrc, nSrcStride, 2 * y + 1), 0, nOutWidth, nChannels,
+                  Row(pDst, nDstStride, y));
+  }
+}
+
+}  // namespace
+
+void HalfSample(const uint8_t* pSrc, size_t nSrcStride, size_t nWidth,
+                size_t nHeight, size_t nChannels, uint8_t* pDst,
+                size_t nDstStride) {
+  if (nChannels != 1) {
+    HalfSampleImage(pSrc, nSrcStride, nWidth, nHeight, nChannels, pDst,
+                    nDstStride);
+    return;
+  }
+  const size_t nOutWidth = nWidth / 2;
+  for (size_t y = 0; y < nHeight / 2; ++y) {
+    const uint8_t* r0 = Row(pSrc, nSrcStride, 2 * y);
+    const uint8_t* r1 = Row(pSrc, nSrcStride, 2 * y + 1);
+    uint8_t* d = Row(pDst, nDstStride, y);
+    HalfSampleRow(r0, r1, HalfSampleGreyRow(r0, r1, nOutWidth, d), nOutWidth,
+                  1, d);
+  }
+}
+
+void HalfSample(const uint16_t* pSrc, size_t nSrcStride, size_t nWidth,
+                size_t nHeight, size_t nChannels, uint16_t* pDst,
+                size_t nDstStride) {
+  HalfSampleImage(pSrc, nSrcStride, nWidth, nHeight, nChannels, pDst,
+                  nDstStride);
+}
+
+void HalfSample(const float* pSrc, size_t nSrcStride, size_t nWidth,
+                size_t nHeight, size_t nChannels, float* pDst,
+                size_t nDstStride) {
+  HalfSampleImage(pSrc, nSrcStride, nWidth, nHeight, nChannels, pDst,
+                  nDstStride);
+}
+
+}  // namespace hal
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace hal {
+
+/**
+ * Halve an image, averaging each 2x2 block of pixels into one.
+ *
+ * The image is `nWidth` by `nHeight` pixels of `nChannels` interleaved
+ * channels; strides are in bytes. The result is nWidth / 2 by
+ * nHeight / 2: an odd last row or column is dropped. Integer averages
+ * are rounded to nearest, as a 0.5 bilinear resize would.
+ *
+ * Single channel 8-bit images, the usual input of trackers, take a
+ * SIMD path (SSE2, AVX2 where the build targets it, or NEON).
+ */
+void HalfSample(const uint8_t* pSrc, size_t nSrcStride, size_t nWidth,
+                size_t nHeight, size_t nChannels, uint8_t* pDst,
+                size_t nDstStride);
+
+void HalfSample(const uint16_t* pSrc, size_t nSrcStride, size_t nWidth,
+                size_t nHeight, size_t nChannels, uint16_t* pDst,
+                size_t nDstStride);
+
+void HalfSample(const float* pSrc, size_t nSrcStride, size_t nWidth,
+                size_t nHeight, size_t nChannels, float* pDst,
+                size_t nDstStride);
+
+}  // namespace hal
@@ -1,16 +1,28 @@
 #include <HAL/Messages/Image.h>
 
+#include <atomic>
 #include <fstream>
 #include <memory>
+#include <utility>
 
 #include <HAL/Messages.pb.h>
+#include <HAL/Messages/ImageLayout.h>
 #include <glog/logging.h>
 
 namespace hal {
 
 void ReadCvMat(const cv::Mat& cvImage, hal::ImageMsg* pbImage) {
-  pbImage->set_data((const char*)cvImage.data,
-                    cvImage.total() * cvImage.elemSize());
+  // Rows of a submatrix are copied in one go, padding and all.
+  const size_t nRowBytes = cvImage.cols * cvImage.elemSize();
+  const size_t nStride = cvImage.rows > 1 ? cvImage.step[0] : nRowBytes;
+  pbImage->set_data((const char*)cvImage.data, cvImage.rows == 0 ? 0 :
+                    (cvImage.rows - 1) * nStride + nRowBytes);
+  pbImage->clear_offset();
+  if (nStride != nRowBytes) {
+    pbImage->set_stride(nStride);
+  } else {
+    pbImage->clear_stride();
+  }
   pbImage->set_height(cvImage.rows);
   pbImage->set_width(cvImage.cols);
 
@@ -61,7 +73,8 @@ cv::Mat WriteCvMat(const hal::ImageMsg& pbImage) {
   }
 
   return cv::Mat(pbImage.height(), pbImage.width(), nCvType,
-                 (void*)pbImage.data().data());
+                 (void*)(pbImage.data().data() + pbImage.offset()),
+                 ImageStride(pbImage));
 }
 
 void ReadFile(const std::string& sFileName, hal::ImageMsg* pbImage) {
@@ -143,6 +156,15 @@ Image::Image(const Image& other) : msg_(new hal::ImageMsg(*other.msg_)),
                                    owns_image_(true) {
 }
 
+Image::Image(Image&& other) : msg_(other.msg_),
+                              source_array_(std::move(other.source_array_)),
+                              mat_(std::move(other.mat_)),
+                              owns_image_(other.owns_image_) {
+  // The message now belongs to this Image, if it belonged to `other`.
+  other.msg_ = nullptr;
+  other.owns_image_ = false;
+}
+
 Image::~Image() {
   if (owns_image_) {
     delete msg_;
@@ -181,12 +203,51 @@ bool Image::HasInfo() const {
   return msg_->has_info();
 }
 
+unsigned int Image::PyramidLevel() const {
+  return msg_->pyramid_level();
+}
+
+bool Image::OwnsImage() const {
+  return owns_image_;
+}
+
 const unsigned char* Image::data() const {
-  return (const unsigned char*)(&msg_->data().front());
+  return (const unsigned char*)(msg_->data().data() + msg_->offset());
+}
+
+size_t Image::Stride() const {
+  return ImageStride(*msg_);
 }
 
 const unsigned char* Image::RowPtr(unsigned int row) const {
-  return data() + (row * Width());
+  return data() + row * Stride();
+}
+
+SharedImage::SharedImage(const std::shared_ptr<Image>& image)
+    : image_(image) {}
+
+SharedImage::SharedImage(Image&& image)
+    : image_(std::make_shared<Image>(std::move(image))) {}
+
+bool SharedImage::Unique() const {
+  // use_count() is a relaxed load. The fence pairs with the release by
+  // which the other owners dropped the image, so that their accesses
+  // to it happen before the caller modifies it.
+  if (image_.use_count() != 1) {
+    return false;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return true;
+}
+
+Image& SharedImage::Mutable() {
+  CHECK(image_) << "Mutable() of an empty SharedImage";
+  // Whoever holds the message, e.g. an ImageArray, may hand it out
+  // again, so an image which doesn't own it is copied too.
+  if (!Unique() || !image_->OwnsImage()) {
+    image_ = std::make_shared<Image>(*image_);
+  }
+  return *image_;
 }
 
 }  // end namespace hal
@@ -56,8 +56,8 @@ class Image {
   /// Performs a DEEP copy of the Image and takes ownership of the image
   Image(const Image& other);
 
-  /// Move constructor performs a SHALLOW copy
-  Image(Image&&) = default;
+  /// Move constructor performs a SHALLOW copy, leaving `other` empty
+  Image(Image&& other);
 
   virtual ~Image();
   unsigned int Width() const;
@@ -68,7 +68,14 @@ class Image {
   double Timestamp() const;
   const hal::ImageInfoMsg& GetInfo() const;
   bool HasInfo() const;
+
+  /// Times the channel was halved to make this image: non-zero for the
+  /// levels a pyramid:// driver adds to a capture.
+  unsigned int PyramidLevel() const;
+  /// First pixel. Rows are Stride() bytes apart, which is more than
+  /// their pixels take if the image is a view of a larger buffer.
   const unsigned char* data() const;
+  size_t Stride() const;
   const unsigned char* RowPtr(unsigned int row = 0) const;
 
   operator cv::Mat() {
@@ -101,6 +108,10 @@ class Image {
     return *(RowPtr(row) + col);
   }
 
+  /// True if this Image made its own copy of the message, rather than
+  /// referring to one held elsewhere, e.g. in an ImageArray.
+  bool OwnsImage() const;
+
  protected:
   const ImageMsg* msg_;
 
@@ -111,4 +122,52 @@ class Image {
   bool owns_image_;
 };
 
+/**
+ * Shared, copy-on-write handle to an Image.
+ *
+ * Opt-in alternative to copying hal::Image: copies of a SharedImage
+ * share the image, so handing frames between threads costs a reference
+ * count rather than a copy of the pixels. Reading goes through the
+ * const accessors; Mutable() makes a private DEEP copy first unless
+ * this handle is the only one and the image owns its message.
+ *
+ * Handles may be copied and read from any thread, but like a
+ * shared_ptr a single handle is not to be modified by two at once.
+ */
+class SharedImage {
+ public:
+  SharedImage() {}
+
+  /// Share an image, e.g. one returned by ImageArray::at(). NO-COPY
+  explicit SharedImage(const std::shared_ptr<Image>& image);
+
+  /// Take over an image. NO-COPY
+  explicit SharedImage(Image&& image);
+
+  const Image& operator*() const {
+    return *image_;
+  }
+
+  const Image* operator->() const {
+    return image_.get();
+  }
+
+  const cv::Mat& Mat() const {
+    return (**this).Mat();
+  }
+
+  explicit operator bool() const {
+    return image_ != nullptr;
+  }
+
+  /// True if no other handle shares the image.
+  bool Unique() const;
+
+  /// The image, copied first if it is shared, to be modified.
+  Image& Mutable();
+
+ private:
+  std::shared_ptr<Image> image_;
+};
+
 }  // end namespace hal
@@ -4,15 +4,23 @@
 #include <memory>
 #include <HAL/Messages.pb.h>
 #include <HAL/Messages/Image.h>
+#include <HAL/Messages/ImagePool.h>
 
 namespace hal {
 
+/// Images of a capture. Their data goes back to the ImageBufferPool
+/// once the array and every Image taken from it are gone, for the
+/// drivers of the next captures to fill.
 class ImageArray : public std::enable_shared_from_this<ImageArray> {
  public:
   static std::shared_ptr<ImageArray> Create() {
     return std::shared_ptr<ImageArray>(new ImageArray);
   }
 
+  ~ImageArray() {
+    ImageBufferPool::Instance().Release(&message_);
+  }
+
   CameraMsg& Ref() {
     return message_;
   }
@@ -0,0 +1,264 @@
+#include <HAL/Messages/ImageCodec.h>
+#include <HAL/Messages/DepthCodec.h>
+#include <HAL/Messages/ImageLayout.h>
+
+#include <ctype.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <glog/logging.h>
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef HAVE_OPENCV
+#include <opencv2/opencv.hpp>
+#endif
+
+namespace hal {
+
+namespace {
+
+#ifdef HAVE_OPENCV
+int CvType(const hal::ImageMsg& img) {
+  const int depth = ImageBytesPerChannel(img) == 2 ? CV_16U : CV_8U;
+  return CV_MAKETYPE(depth, ImageChannels(img));
+}
+#endif
+
+bool Encode(hal::ImageCodec codec, int nLevel, const hal::ImageMsg& img,
+            std::string* out) {
+  const std::string& data = img.data();
+  out->clear();
+  (void)nLevel;  // Unused when built without the optional codecs.
+  switch (codec) {
+    case hal::PB_CODEC_DEPTH16:
+      EncodeDepth16(reinterpret_cast<const uint16_t*>(data.data()),
+                    data.size() / 2, out);
+      return true;
+
+#ifdef HAVE_LZ4
+    case hal::PB_CODEC_LZ4: {
+      out->resize(LZ4_compressBound(data.size()));
+      const int size = LZ4_compress_fast(
+          data.data(), &(*out)[0], data.size(), out->size(),
+          nLevel > 0 ? nLevel : 1);
+      out->resize(size);
+      return size > 0;
+    }
+#endif
+
+#ifdef HAVE_ZSTD
+    case hal::PB_CODEC_ZSTD: {
+      out->resize(ZSTD_compressBound(data.size()));
+      const size_t size = ZSTD_compress(
+          &(*out)[0], out->size(), data.data(), data.size(),
+          nLevel != 0 ? nLevel : 1);
+      if (ZSTD_isError(size)) {
+        return false;
+      }
+      out->resize(size);
+      return true;
+    }
+#endif
+
+#ifdef HAVE_OPENCV
+    case hal::PB_CODEC_PNG: {
+      const cv::Mat mat(img.height(), img.width(), CvType(img),
+                        const_cast<char*>(data.data()));
+      std::vector<int> params;
+      params.push_back(cv::IMWRITE_PNG_COMPRESSION);
+      params.push_back(nLevel > 0 ? nLevel : 1);
+      std::vector<unsigned char> buffer;
+      if (!cv::imencode(".png", mat, buffer, params)) {
+        return false;
+      }
+      out->assign(buffer.begin(), buffer.end());
+      return true;
+    }
+
+    case hal::PB_CODEC_JPEG: {
+      const cv::Mat mat(img.height(), img.width(), CvType(img),
+                        const_cast<char*>(data.data()));
+      std::vector<int> params;
+      params.push_back(cv::IMWRITE_JPEG_QUALITY);
+      params.push_back(nLevel > 0 ? nLevel : 90);
+      std::vector<unsigned char> buffer;
+      if (!cv::imencode(".jpg", mat, buffer, params)) {
+        return false;
+      }
+      out->assign(buffer.begin(), buffer.end());
+      return true;
+    }
+#endif
+
+    default:
+      return false;
+  }
+}
+
+bool HasPixels(const hal::ImageMsg& img) {
+  return ImageChannels(img) != 0 && HasImageLayout(img);
+}
+
+}  // namespace
+
+bool IsImageCodecAvailable(hal::ImageCodec codec) {
+  switch (codec) {
+    case hal::PB_CODEC_NONE:
+    case hal::PB_CODEC_DEPTH16:
+      return true;
+#ifdef HAVE_LZ4
+    case hal::PB_CODEC_LZ4:
+      return true;
+#endif
+#ifdef HAVE_ZSTD
+    case hal::PB_CODEC_ZSTD:
+      return true;
+#endif
+#ifdef HAVE_OPENCV
+    case hal::PB_CODEC_PNG:
+    case hal::PB_CODEC_JPEG:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+bool ParseImageCodec(const std::string& sName, hal::ImageCodec* codec) {
+  std::string sUpper = sName;
+  for (char& c : sUpper) {
+    c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+  }
+  if (sUpper == "JPG") {
+    sUpper = "JPEG";
+  }
+  return hal::ImageCodec_Parse(sUpper, codec) ||
+      hal::ImageCodec_Parse("PB_CODEC_" + sUpper, codec);
+}
+
+bool IsDepthImage(const hal::ImageMsg& img) {
+  return img.format() == hal::PB_LUMINANCE &&
+      (img.type() == hal::PB_UNSIGNED_SHORT || img.type() == hal::PB_SHORT);
+}
+
+bool ImageCodecSupports(hal::ImageCodec codec, const hal::ImageMsg& img) {
+  switch (codec) {
+    case hal::PB_CODEC_DEPTH16:
+      return ImageBytesPerChannel(img) == 2 && ImageChannels(img) == 1 &&
+          img.data().size() % 2 == 0;
+    case hal::PB_CODEC_PNG:
+      return (ImageBytesPerChannel(img) == 1 || ImageBytesPerChannel(img) == 2) &&
+          HasPixels(img);
+    case hal::PB_CODEC_JPEG:
+      // Lossy coding would mix up the colours of a Bayer pattern.
+      return ImageBytesPerChannel(img) == 1 && img.format() != hal::PB_RAW &&
+          (ImageChannels(img) == 1 || ImageChannels(img) == 3) && HasPixels(img);
+    default:
+      return true;
+  }
+}
+
+bool EncodeImage(hal::ImageCodec codec, int nLevel, hal::ImageMsg* img) {
+  if (codec == hal::PB_CODEC_NONE || img->codec() != hal::PB_CODEC_NONE ||
+      !IsImageCodecAvailable(codec) || !ImageCodecSupports(codec, *img) ||
+      !PackImage(img)) {
+    return false;
+  }
+
+  // Swapping with a per thread scratch buffer keeps both allocations
+  // around for the next image.
+  static thread_local std::string scratch;
+  if (!Encode(codec, nLevel, *img, &scratch)) {
+    LOG(WARNING) << "HAL: Failed to encode image with codec "
+                 << hal::ImageCodec_Name(codec) << ".";
+    return false;
+  }
+  img->set_raw_size(img->data().size());
+  img->mutable_data()->swap(scratch);
+  img->set_codec(codec);
+  return true;
+}
+
+bool DecodeImageData(const hal::ImageMsg& img, const unsigned char* pData,
+                     size_t nSize, std::string* out) {
+  const size_t nRawSize = img.raw_size();
+  switch (img.codec()) {
+    case hal::PB_CODEC_NONE:
+      out->assign(reinterpret_cast<const char*>(pData), nSize);
+      return true;
+
+    case hal::PB_CODEC_DEPTH16:
+      out->resize(nRawSize);
+      return nRawSize % 2 == 0 &&
+          DecodeDepth16(pData, nSize, reinterpret_cast<uint16_t*>(&(*out)[0]),
+                        nRawSize / 2);
+
+#ifdef HAVE_LZ4
+    case hal::PB_CODEC_LZ4:
+      out->resize(nRawSize);
+      return LZ4_decompress_safe(reinterpret_cast<const char*>(pData),
+                                 &(*out)[0], nSize, nRawSize) ==
+          static_cast<int>(nRawSize);
+#endif
+
+#ifdef HAVE_ZSTD
+    case hal::PB_CODEC_ZSTD:
+      out->resize(nRawSize);
+      return ZSTD_decompress(&(*out)[0], nRawSize, pData, nSize) == nRawSize;
+#endif
+
+#ifdef HAVE_OPENCV
+    case hal::PB_CODEC_PNG:
+    case hal::PB_CODEC_JPEG: {
+      const cv::Mat buffer(1, nSize, CV_8UC1, const_cast<unsigned char*>(pData));
+      const cv::Mat mat = cv::imdecode(buffer, cv::IMREAD_UNCHANGED);
+      if (mat.type() != CvType(img) || !mat.isContinuous() ||
+          mat.total() * mat.elemSize() != nRawSize) {
+        return false;
+      }
+      out->assign(reinterpret_cast<const char*>(mat.data), nRawSize);
+      return true;
+    }
+#endif
+
+    default:
+      LOG(WARNING) << "HAL: Codec " << hal::ImageCodec_Name(img.codec())
+                   << " is not available in this build.";
+      return false;
+  }
+}
+
+bool DecodeImage(hal::ImageMsg* img) {
+  if (img->codec() == hal::PB_CODEC_NONE) {
+    return true;
+  }
+
+  static thread_local std::string scratch;
+  const std::string& data = img->data();
+  if (!DecodeImageData(*img, reinterpret_cast<const unsigned char*>(
+          data.data()), data.size(), &scratch)) {
+    return false;
+  }
+  img->mutable_data()->swap(scratch);
+  img->clear_codec();
+  img->clear_raw_size();
+  return true;
+}
+
+bool DecodeCameraMsg(hal::CameraMsg* msg) {
+  bool ok = true;
+  for (int ii = 0; ii < msg->image_size(); ++ii) {
+    ok = DecodeImage(msg->mutable_image(ii)) && ok;
+  }
+  return ok;
+}
+
+}  // namespace hal
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <string>
+
+#include <HAL/Messages.pb.h>
+
+namespace hal {
+
+/// True if this build of HAL can encode and decode `codec`.
+bool IsImageCodecAvailable(hal::ImageCodec codec);
+
+/// Look up a codec by name, e.g. "lz4", "jpeg" or "PB_CODEC_ZSTD", in
+/// any case. Returns false if there is no such codec.
+bool ParseImageCodec(const std::string& sName, hal::ImageCodec* codec);
+
+/// True for single channel 16-bit images, the output of depth cameras,
+/// which usually want a codec of their own.
+bool IsDepthImage(const hal::ImageMsg& img);
+
+/// True if `codec` can encode images of this type and format.
+bool ImageCodecSupports(hal::ImageCodec codec, const hal::ImageMsg& img);
+
+/**
+ * Compress the data of an image in place and record the codec in it.
+ *
+ * Views of a larger buffer are packed first, see ImageLayout.h.
+ * `nLevel` is passed on to the codec (0 picks its default). Returns
+ * false, leaving the image as it is, if the image is already encoded,
+ * the codec is unavailable or does not support the image.
+ */
+bool EncodeImage(hal::ImageCodec codec, int nLevel, hal::ImageMsg* img);
+
+/// Restore the raw pixel data of an encoded image in place. Returns
+/// true if the image holds raw pixels afterwards.
+bool DecodeImage(hal::ImageMsg* img);
+
+/// Decode image data stored apart from its message, e.g. in a memory
+/// mapped log, into `out`. `img` provides the codec and image layout.
+bool DecodeImageData(const hal::ImageMsg& img, const unsigned char* pData,
+                     size_t nSize, std::string* out);
+
+/// Decode every image of a camera message.
+bool DecodeCameraMsg(hal::CameraMsg* msg);
+
+}  // namespace hal
@@ -0,0 +1,103 @@
+#include <HAL/Messages/ImageLayout.h>
+
+#include <string.h>
+
+#include <string>
+
+namespace hal {
+
+size_t ImageBytesPerChannel(const hal::ImageMsg& img) {
+  switch (img.type()) {
+    case hal::PB_BYTE:
+    case hal::PB_UNSIGNED_BYTE:
+      return 1;
+    case hal::PB_SHORT:
+    case hal::PB_UNSIGNED_SHORT:
+      return 2;
+    case hal::PB_INT:
+    case hal::PB_UNSIGNED_INT:
+    case hal::PB_FLOAT:
+      return 4;
+    case hal::PB_DOUBLE:
+      return 8;
+  }
+  return 0;
+}
+
+int ImageChannels(const hal::ImageMsg& img) {
+  switch (img.format()) {
+    case hal::PB_LUMINANCE:
+    case hal::PB_RAW:
+      return 1;
+    case hal::PB_RGB:
+    case hal::PB_BGR:
+      return 3;
+    case hal::PB_RGBA:
+    case hal::PB_BGRA:
+      return 4;
+  }
+  return 0;
+}
+
+size_t ImageBytesPerPixel(const hal::ImageMsg& img) {
+  return ImageChannels(img) * ImageBytesPerChannel(img);
+}
+
+size_t ImageRowBytes(const hal::ImageMsg& img) {
+  return img.width() * ImageBytesPerPixel(img);
+}
+
+size_t ImageStride(const hal::ImageMsg& img) {
+  return img.stride() != 0 ? img.stride() : ImageRowBytes(img);
+}
+
+bool IsPackedImage(const hal::ImageMsg& img) {
+  return img.offset() == 0 &&
+      (img.stride() == 0 || img.stride() == ImageRowBytes(img));
+}
+
+bool HasImageLayout(const hal::ImageMsg& img) {
+  const size_t nSize = img.data().size();
+  const size_t nRowBytes = ImageRowBytes(img);
+  const size_t nStride = ImageStride(img);
+  if (img.offset() > nSize || nStride < nRowBytes) {
+    return false;
+  }
+  if (img.height() == 0 || nStride == 0) {
+    return true;
+  }
+  // The last row ends at offset + (height - 1) * stride + row bytes.
+  const size_t nAvailable = nSize - img.offset();
+  return nAvailable >= nRowBytes &&
+      (nAvailable - nRowBytes) / nStride >= img.height() - 1;
+}
+
+bool PackImage(hal::ImageMsg* img) {
+  if (IsPackedImage(*img)) {
+    img->clear_stride();
+    img->clear_offset();
+    return true;
+  }
+  if (!HasImageLayout(*img)) {
+    return false;
+  }
+
+  // Rows only move towards the start of the data, so moving them in
+  // order never overwrites one yet to be moved.
+  const size_t nRowBytes = ImageRowBytes(*img);
+  const size_t nStride = ImageStride(*img);
+  std::string* data = img->mutable_data();
+  char* pDst = &(*data)[0];
+  const char* pSrc = pDst + img->offset();
+  for (unsigned int row = 0; row < img->height(); ++row) {
+    memmove(pDst, pSrc, nRowBytes);
+    pDst += nRowBytes;
+    pSrc += nStride;
+  }
+  data->resize(nRowBytes * img->height());
+  img->clear_stride();
+  img->clear_offset();
+  return true;
+}
+
+}  // namespace hal
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <HAL/Messages.pb.h>
+
+namespace hal {
+
+/**
+ * Layout of the pixels in ImageMsg.data.
+ *
+ * Rows are `stride` bytes apart, starting `offset` bytes into the data,
+ * so an image can be a view of part of a larger buffer: a crop, a field
+ * of an interlaced frame, or a driver buffer with padded rows, without
+ * copying it. Images without either field are tightly packed.
+ *
+ * Code which needs packed pixels, e.g. to compress or log an image,
+ * calls PackImage() first.
+ */
+
+/// Bytes of one channel of a pixel, 0 for an unknown type.
+size_t ImageBytesPerChannel(const hal::ImageMsg& img);
+
+/// Channels of a pixel, 0 for an unknown format.
+int ImageChannels(const hal::ImageMsg& img);
+
+size_t ImageBytesPerPixel(const hal::ImageMsg& img);
+
+/// Bytes of pixels in a row, not counting padding.
+size_t ImageRowBytes(const hal::ImageMsg& img);
+
+/// Bytes from the start of one row to the start of the next.
+size_t ImageStride(const hal::ImageMsg& img);
+
+/// True if the rows are back to back from the start of the data.
+bool IsPackedImage(const hal::ImageMsg& img);
+
+/// True if the data holds every row the layout refers to.
+bool HasImageLayout(const hal::ImageMsg& img);
+
+/// Make the image tightly packed, moving its rows within the data.
+/// Returns false, leaving the image as it is, if the data is too small
+/// for the layout.
+bool PackImage(hal::ImageMsg* img);
+
+}  // namespace hal
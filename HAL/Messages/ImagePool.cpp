@@ -0,0 +1,107 @@
+#include <HAL/Messages/ImagePool.h>
+
+namespace hal {
+
+namespace {
+
+const size_t kMinBytes = 64 << 10;
+
+/// Smallest size class holding `nBytes`.
+size_t CeilClass(size_t nBytes) {
+  size_t base = kMinBytes;
+  while (2 * base < nBytes) {
+    base *= 2;
+  }
+  const size_t step = base / 4;
+  return nBytes <= base ? base : base + (nBytes - base + step - 1) / step * step;
+}
+
+/// Largest size class a buffer of `nCapacity` holds.
+size_t FloorClass(size_t nCapacity) {
+  size_t base = kMinBytes;
+  while (2 * base <= nCapacity) {
+    base *= 2;
+  }
+  const size_t step = base / 4;
+  return base + (nCapacity - base) / step * step;
+}
+
+}  // namespace
+
+ImageBufferPool& ImageBufferPool::Instance() {
+  // Never destroyed: images may be released during static destruction.
+  static ImageBufferPool* pPool = new ImageBufferPool;
+  return *pPool;
+}
+
+ImageBufferPool::ImageBufferPool() : m_nBytes(0), m_nMaxBytes(256 << 20) {}
+
+size_t ImageBufferPool::MinBytes() {
+  return kMinBytes;
+}
+
+void ImageBufferPool::SetMaxBytes(size_t nBytes) {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_nMaxBytes = nBytes;
+  while (m_nBytes > m_nMaxBytes && !m_mBuffers.empty()) {
+    auto it = m_mBuffers.begin();
+    m_nBytes -= it->first * it->second.size();
+    m_mBuffers.erase(it);
+  }
+}
+
+void ImageBufferPool::Resize(size_t nBytes, std::string* data) {
+  if (data->capacity() >= nBytes || nBytes < kMinBytes) {
+    data->resize(nBytes);
+    return;
+  }
+  Release(data);
+
+  // An exact fit, or failing that a buffer of the next class or two.
+  const size_t nClass = CeilClass(nBytes);
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_mBuffers.lower_bound(nClass);
+    if (it != m_mBuffers.end() && it->first <= nClass + nClass / 2) {
+      data->swap(it->second.back());
+      it->second.pop_back();
+      m_nBytes -= it->first;
+      if (it->second.empty()) {
+        m_mBuffers.erase(it);
+      }
+    }
+  }
+  if (data->capacity() < nBytes) {
+    data->reserve(nClass);
+  }
+  // Pooled buffers keep their length, so this only fills bytes the
+  // buffer has not held before.
+  data->resize(nBytes);
+}
+
+void ImageBufferPool::Release(std::string* data) {
+  if (data->capacity() < kMinBytes) {
+    data->clear();
+    return;
+  }
+  const size_t nClass = FloorClass(data->capacity());
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_nBytes + nClass <= m_nMaxBytes) {
+      std::vector<std::string>& bucket = m_mBuffers[nClass];
+      bucket.emplace_back();
+      bucket.back().swap(*data);
+      m_nBytes += nClass;
+      return;
+    }
+  }
+  std::string().swap(*data);
+}
+
+void ImageBufferPool::Release(hal::CameraMsg* msg) {
+  for (int ii = 0; ii < msg->image_size(); ++ii) {
+    Release(msg->mutable_image(ii)->mutable_data());
+  }
+}
+
+}  // namespace hal
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <HAL/Messages.pb.h>
+
+namespace hal {
+
+/**
+ * Process wide pool of image data buffers.
+ *
+ * Drivers which make a new image each frame size its data through the
+ * pool instead of resizing the empty string of a fresh ImageMsg, which
+ * costs a large allocation, page faults on its first use and a free
+ * every frame. Buffers are handed back by hal::ImageArray when it goes
+ * away, or by Release() on messages which are done with.
+ *
+ * Buffers are kept in size classes, four per power of two, so images of
+ * the same size keep landing on the same buffers. Only buffers of at
+ * least MinBytes() are kept: smaller ones are cheap to allocate.
+ *
+ * Thread safe.
+ */
+class ImageBufferPool {
+ public:
+  static ImageBufferPool& Instance();
+
+  /// Make `data` `nBytes` long, on its own storage if large enough or
+  /// else on a pooled buffer. Contents are undefined.
+  void Resize(size_t nBytes, std::string* data);
+
+  /// Hand the storage of `data` to the pool, leaving it empty.
+  void Release(std::string* data);
+
+  /// Release the data of every image of `msg`.
+  void Release(hal::CameraMsg* msg);
+
+  /// Most bytes of buffers the pool holds on to. 256 MB by default.
+  void SetMaxBytes(size_t nBytes);
+
+  static size_t MinBytes();
+
+ private:
+  ImageBufferPool();
+
+  std::mutex                                   m_Mutex;
+  std::map<size_t, std::vector<std::string>>   m_mBuffers;  // By class.
+  size_t                                       m_nBytes;
+  size_t                                       m_nMaxBytes;
+};
+
+}  // namespace hal
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <vector>
+
 #include <miniglog/logging.h>
+#include <HAL/Messages/HalfSample.h>
 #include <HAL/Messages/Image.h>
+#include <HAL/Messages/ImageArray.h>
+#include <HAL/Utils/WorkerPool.h>
 
 namespace hal {
 class ImagePyramid {
@@ -35,13 +40,20 @@ class ImagePyramid {
 
     scale_factor_ = other.scale_factor_;
     num_levels_ = other.num_levels_;
+    levels_.clear();
+    attached_.clear();
+    if (!other.image_) {
+      image_.reset();
+      return;
+    }
     image_ = std::make_shared<Image>(*other.image_);
 
     levels_.reserve(other.levels_.size());
     levels_.emplace_back(image_->Mat());
-    for (size_t level = 1; level < num_levels_; ++level) {
+    for (size_t level = 1; level < other.levels_.size(); ++level) {
       levels_.emplace_back(other.levels_[level].clone());
     }
+    attached_.assign(levels_.size(), false);
   }
 
   /**
@@ -49,16 +61,68 @@ class ImagePyramid {
    * intrinsic parameters (scale, # levels).
    *
    * This also allows reuse of an ImagePyramid structure, as long as
-   * its parameters don't change.
+   * its parameters don't change: levels keep their storage from one
+   * image to the next. Halving levels of 8, 16-bit and float images
+   * take a dedicated 2x2 averaging kernel (see hal::HalfSample()),
+   * other scales and types cv::resize.
    */
   void Build(const std::shared_ptr<Image>& image) {
     levels_.resize(num_levels_);
+    attached_.resize(num_levels_);
     image_ = image;
     levels_[0] = image->Mat();
 
     for (size_t level = 1; level < num_levels_; ++level) {
-      cv::resize(levels_[level - 1], levels_[level],
-                 cv::Size(), scale_factor_, scale_factor_);
+      Detach(level);
+      if (scale_factor_ != 0.5 ||
+          !HalfSampleLevel(levels_[level - 1], &levels_[level])) {
+        cv::resize(levels_[level - 1], levels_[level],
+                   cv::Size(), scale_factor_, scale_factor_);
+      }
+    }
+  }
+
+  /**
+   * (Re)Build the pyramid of channel `channel` of a capture, taking the
+   * levels a pyramid:// driver added to it instead of computing them.
+   *
+   * Such a capture holds its N channels followed by their levels, level
+   * `l` of the channel being image `channel + l * N`. Levels the capture
+   * lacks, or all of them unless halving, are built as usual.
+   */
+  void Build(const ImageArray& images, size_t channel) {
+    image_ = images.at(channel);
+    if (scale_factor_ != 0.5) {
+      Build(image_);
+      return;
+    }
+
+    size_t num_channels = 0;
+    for (int ii = 0; ii < images.Size(); ++ii) {
+      if (images.at(ii)->PyramidLevel() == 0) {
+        ++num_channels;
+      }
+    }
+
+    levels_.resize(num_levels_);
+    attached_.resize(num_levels_);
+    levels_[0] = image_->Mat();
+    bool attached = true;
+    for (size_t level = 1; level < num_levels_; ++level) {
+      const size_t idx = channel + level * num_channels;
+      if (attached && idx < static_cast<size_t>(images.Size()) &&
+          images.at(idx)->PyramidLevel() == level) {
+        // image_ keeps the capture, and so the level's data, alive.
+        levels_[level] = images.at(idx)->Mat();
+        attached_[level] = true;
+        continue;
+      }
+      attached = false;
+      Detach(level);
+      if (!HalfSampleLevel(levels_[level - 1], &levels_[level])) {
+        cv::resize(levels_[level - 1], levels_[level],
+                   cv::Size(), scale_factor_, scale_factor_);
+      }
     }
   }
 
@@ -94,13 +158,86 @@ class ImagePyramid {
   }
 
  private:
+  /// Drop a level taken from a capture before computing it: cv::Mat
+  /// would otherwise write into the capture's data, as it keeps a level
+  /// of the same shape.
+  void Detach(size_t level) {
+    if (attached_[level]) {
+      levels_[level] = cv::Mat();
+      attached_[level] = false;
+    }
+  }
+
+  /// Halve `src` into `dst`. False, leaving `dst` alone, for shapes and
+  /// types cv::resize is left to, e.g. odd sizes, which it rounds
+  /// differently.
+  static bool HalfSampleLevel(const cv::Mat& src, cv::Mat* dst) {
+    if (src.rows < 2 || src.cols < 2 || src.rows % 2 || src.cols % 2) {
+      return false;
+    }
+    const int depth = src.depth();
+    if (depth != CV_8U && depth != CV_16U && depth != CV_32F) {
+      return false;
+    }
+    // Allocates only if the level changed shape.
+    dst->create(src.rows / 2, src.cols / 2, src.type());
+    if (depth == CV_8U) {
+      HalfSample(src.ptr<uint8_t>(), src.step[0], src.cols, src.rows,
+                 src.channels(), dst->ptr<uint8_t>(), dst->step[0]);
+    } else if (depth == CV_16U) {
+      HalfSample(src.ptr<uint16_t>(), src.step[0], src.cols, src.rows,
+                 src.channels(), dst->ptr<uint16_t>(), dst->step[0]);
+    } else {
+      HalfSample(src.ptr<float>(), src.step[0], src.cols, src.rows,
+                 src.channels(), dst->ptr<float>(), dst->step[0]);
+    }
+    return true;
+  }
+
   // We hold onto the image that created us to ensure its lifetime
   std::shared_ptr<Image> image_;
 
   // The pyramid levels
   std::vector<cv::Mat> levels_;
 
+  // Levels whose data belongs to the capture of image_
+  std::vector<bool> attached_;
+
   size_t num_levels_;
   double scale_factor_;
 };
+
+/**
+ * Build a pyramid of every channel of `images`, the channels in
+ * parallel on `workers`, which the caller keeps from one capture to
+ * the next. Levels a pyramid:// driver added to the capture are taken
+ * as they are (see ImagePyramid::Build(const ImageArray&, size_t)).
+ *
+ * Pyramids already in `pyramids` with the same parameters are reused,
+ * level storage included, so once the image sizes settle each capture
+ * only allocates the Image handles ImageArray::at() hands out.
+ */
+inline void BuildPyramids(const ImageArray& images, size_t num_levels,
+                          double scale_factor, WorkerPool* workers,
+                          std::vector<ImagePyramid>* pyramids) {
+  size_t num_channels = 0;
+  for (int ii = 0; ii < images.Size(); ++ii) {
+    if (images.at(ii)->PyramidLevel() == 0) {
+      ++num_channels;
+    }
+  }
+
+  pyramids->resize(num_channels, ImagePyramid(num_levels, scale_factor));
+  for (ImagePyramid& pyramid : *pyramids) {
+    if (pyramid.NumLevels() != num_levels ||
+        pyramid.ScaleFactor() != scale_factor) {
+      pyramid = ImagePyramid(num_levels, scale_factor);
+    }
+  }
+
+  // Small enough a capture for std::function to keep it inline.
+  workers->Run(num_channels, [&images, pyramids](size_t ii) {
+      (*pyramids)[ii].Build(images, ii);
+    });
+}
 }  // end namespace hal
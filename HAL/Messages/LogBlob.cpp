@@ -0,0 +1,209 @@
+#include <HAL/Messages/LogBlob.h>
+
+#include <algorithm>
+#include <climits>
+#include <limits>
+#include <vector>
+
+#include <glog/logging.h>
+#include <google/protobuf/wire_format_lite.h>
+
+namespace hal {
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::internal::WireFormatLite;
+
+namespace {
+
+const uint32_t kBlobTag = WireFormatLite::MakeTag(
+    hal::Msg::kBlobFieldNumber, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+const uint32_t kPaddingTag = WireFormatLite::MakeTag(
+    hal::Msg::kBlobPaddingFieldNumber,
+    WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+
+const char kZeros[4096] = {};
+
+/// Length of the padding field placed at `nPos` so that the blob field
+/// after it, whose tag and length take `nHeader` bytes, starts its data
+/// on an `nAlignment` boundary. -1 if no padding is needed.
+int64_t PaddingLength(uint64_t nPos, size_t nHeader, size_t nAlignment) {
+  if (nAlignment <= 1) {
+    return -1;
+  }
+  const uint64_t gap = (nAlignment - (nPos + nHeader) % nAlignment) %
+      nAlignment;
+  if (gap == 0) {
+    return -1;
+  }
+
+  // The padding field is its tag, a varint length and that many zeros.
+  // Some gaps can't be filled that way, e.g. 130 bytes: the next
+  // boundary always can.
+  const size_t nTag = CodedOutputStream::VarintSize32(kPaddingTag);
+  for (uint64_t fill = gap; ; fill += nAlignment) {
+    for (size_t nVarint = 1; nVarint <= 5 && nTag + nVarint <= fill;
+         ++nVarint) {
+      const uint64_t length = fill - nTag - nVarint;
+      if (length <= std::numeric_limits<uint32_t>::max() &&
+          CodedOutputStream::VarintSize32(length) == nVarint) {
+        return length;
+      }
+    }
+  }
+}
+
+/// WriteBlobRecord() for any list of blobs: `blob(ii)` is the ImageView
+/// of the ii-th of `nBlobs`.
+template <typename Blob>
+uint64_t WriteBlobs(CodedOutputStream* output, uint64_t nOffset,
+                    size_t nAlignment, const std::string& meta, int nBlobs,
+                    Blob&& blob) {
+  // Where the blobs land depends on the size of the record's own length
+  // prefix, which depends on the padding: try each prefix size until
+  // they agree. Should none, the record is still valid, only unaligned.
+  std::vector<int64_t> vPadding(nBlobs);
+  uint64_t nSize = 0;
+  for (size_t nPrefix = 1; nPrefix <= 5; ++nPrefix) {
+    uint64_t pos = nOffset + nPrefix + meta.size();
+    for (int ii = 0; ii < nBlobs; ++ii) {
+      const size_t nHeader = CodedOutputStream::VarintSize32(kBlobTag) +
+          CodedOutputStream::VarintSize32(blob(ii).size);
+      vPadding[ii] = PaddingLength(pos, nHeader, nAlignment);
+      if (vPadding[ii] >= 0) {
+        pos += CodedOutputStream::VarintSize32(kPaddingTag) +
+            CodedOutputStream::VarintSize32(vPadding[ii]) + vPadding[ii];
+      }
+      pos += nHeader + blob(ii).size;
+    }
+    nSize = pos - nOffset - nPrefix;
+    if (CodedOutputStream::VarintSize64(nSize) == nPrefix) {
+      break;
+    }
+  }
+  LOG_IF(ERROR, nSize > std::numeric_limits<int>::max())
+      << "HAL: Record of " << nSize << " bytes is too large to be read.";
+
+  output->WriteVarint32(static_cast<uint32_t>(nSize));
+  output->WriteRaw(meta.data(), meta.size());
+  for (int ii = 0; ii < nBlobs; ++ii) {
+    if (vPadding[ii] >= 0) {
+      output->WriteTag(kPaddingTag);
+      output->WriteVarint32(static_cast<uint32_t>(vPadding[ii]));
+      for (int64_t left = vPadding[ii]; left > 0; ) {
+        const int n = static_cast<int>(
+            std::min<int64_t>(left, sizeof(kZeros)));
+        output->WriteRaw(kZeros, n);
+        left -= n;
+      }
+    }
+    const ImageView view = blob(ii);
+    output->WriteTag(kBlobTag);
+    output->WriteVarint32(view.size);
+    output->WriteRaw(view.data, view.size);
+  }
+  return CodedOutputStream::VarintSize32(static_cast<uint32_t>(nSize)) +
+      nSize;
+}
+
+}  // namespace
+
+int DetachImageBlobs(hal::CameraMsg* camera, size_t nMinBytes,
+                     google::protobuf::RepeatedPtrField<std::string>* blobs) {
+  blobs->Clear();
+  for (int ii = 0; ii < camera->image_size(); ++ii) {
+    hal::ImageMsg* pImage = camera->mutable_image(ii);
+    if (pImage->data().size() < nMinBytes || pImage->data().empty()) {
+      pImage->clear_blob();
+      continue;
+    }
+    pImage->set_blob(blobs->size());
+    blobs->Add()->swap(*pImage->mutable_data());
+    pImage->clear_data();
+  }
+  return blobs->size();
+}
+
+bool AttachImageBlobs(hal::Msg* msg) {
+  bool ok = true;
+  if (msg->has_camera()) {
+    hal::CameraMsg* pCamera = msg->mutable_camera();
+    for (int ii = 0; ii < pCamera->image_size(); ++ii) {
+      hal::ImageMsg* pImage = pCamera->mutable_image(ii);
+      if (!pImage->has_blob()) {
+        continue;
+      }
+      if (pImage->blob() < static_cast<uint32_t>(msg->blob_size())) {
+        pImage->mutable_data()->swap(*msg->mutable_blob(pImage->blob()));
+      } else {
+        ok = false;
+      }
+      pImage->clear_blob();
+    }
+  }
+  msg->clear_blob();
+  msg->clear_blob_padding();
+  return ok;
+}
+
+uint64_t WriteBlobRecord(
+    CodedOutputStream* output, uint64_t nOffset, size_t nAlignment,
+    const std::string& meta,
+    const google::protobuf::RepeatedPtrField<std::string>& blobs) {
+  return WriteBlobs(output, nOffset, nAlignment, meta, blobs.size(),
+                    [&blobs](int ii) {
+      const std::string& blob = blobs.Get(ii);
+      return ImageView(reinterpret_cast<const unsigned char*>(blob.data()),
+                       blob.size());
+    });
+}
+
+uint64_t WriteBlobRecord(CodedOutputStream* output, uint64_t nOffset,
+                         size_t nAlignment, const std::string& meta,
+                         const std::vector<ImageView>& blobs) {
+  return WriteBlobs(output, nOffset, nAlignment, meta, blobs.size(),
+                    [&blobs](int ii) { return blobs[ii]; });
+}
+
+bool SplitBlobRecord(const unsigned char* pData, size_t nSize,
+                     std::string* meta, std::vector<ImageView>* blobs) {
+  meta->clear();
+  blobs->clear();
+  if (nSize > INT_MAX) {
+    return false;
+  }
+
+  CodedInputStream input(pData, static_cast<int>(nSize));
+  int start = 0;
+  while (uint32_t tag = input.ReadTag()) {
+    const int field = WireFormatLite::GetTagFieldNumber(tag);
+    if (field == hal::Msg::kBlobFieldNumber ||
+        field == hal::Msg::kBlobPaddingFieldNumber) {
+      uint32_t length;
+      if (WireFormatLite::GetTagWireType(tag) !=
+          WireFormatLite::WIRETYPE_LENGTH_DELIMITED ||
+          !input.ReadVarint32(&length)) {
+        return false;
+      }
+      const int pos = input.CurrentPosition();
+      if (length > nSize - pos || !input.Skip(length)) {
+        return false;
+      }
+      if (field == hal::Msg::kBlobFieldNumber) {
+        blobs->push_back(ImageView(pData + pos, length));
+      }
+    } else {
+      // Blobs are the last fields of their record.
+      if (!blobs->empty() || !WireFormatLite::SkipField(&input, tag)) {
+        return false;
+      }
+      meta->append(reinterpret_cast<const char*>(pData) + start,
+                   input.CurrentPosition() - start);
+    }
+    start = input.CurrentPosition();
+  }
+  return !blobs->empty() && input.ConsumedEntireMessage() &&
+      static_cast<size_t>(input.CurrentPosition()) == nSize;
+}
+
+}  // namespace hal
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/repeated_field.h>
+
+#include <HAL/Messages.pb.h>
+#include <HAL/Messages/MappedLog.h>
+
+namespace hal {
+
+/**
+ * Out of band image data.
+ *
+ * Large image data can be stored as blobs of the enclosing hal::Msg
+ * instead of in ImageMsg.data. Blobs are the last fields of their
+ * record, each preceded by just enough padding for its bytes to start
+ * on an aligned offset of the log file, so a memory mapped reader hands
+ * out aligned pixels without parsing them (see hal::MappedCameraMsg).
+ * The record is still a plain hal::Msg: readers which don't know about
+ * blobs skip them. Tools copying records to another offset have to lay
+ * them out again for the blobs to stay aligned, see SplitBlobRecord().
+ */
+
+/// Move the data of the images of at least `nMinBytes` into `blobs`,
+/// leaving the index of its blob in each image. `blobs` is cleared
+/// first, keeping its strings around for reuse. Returns the number of
+/// images moved.
+int DetachImageBlobs(hal::CameraMsg* camera, size_t nMinBytes,
+                     google::protobuf::RepeatedPtrField<std::string>* blobs);
+
+/// Move the blobs of a parsed message back into the images they belong
+/// to and drop them, along with the padding. Returns false if an image
+/// refers to a blob the message does not have.
+bool AttachImageBlobs(hal::Msg* msg);
+
+/**
+ * Write a record, size prefix included, holding `meta` (a hal::Msg
+ * serialized without blobs) followed by `blobs`.
+ *
+ * Each blob is padded to start at a multiple of `nAlignment` bytes into
+ * the file, given that the record starts at `nOffset`. Returns the size
+ * of the record.
+ */
+uint64_t WriteBlobRecord(
+    google::protobuf::io::CodedOutputStream* output, uint64_t nOffset,
+    size_t nAlignment, const std::string& meta,
+    const google::protobuf::RepeatedPtrField<std::string>& blobs);
+
+/// Same, for blobs held elsewhere, e.g. in a memory mapped log.
+uint64_t WriteBlobRecord(
+    google::protobuf::io::CodedOutputStream* output, uint64_t nOffset,
+    size_t nAlignment, const std::string& meta,
+    const std::vector<ImageView>& blobs);
+
+/// Split a record written by WriteBlobRecord(), without its size
+/// prefix, back into `meta` and its blobs, which point into `pData`.
+/// Returns false if the record has no blobs.
+bool SplitBlobRecord(const unsigned char* pData, size_t nSize,
+                     std::string* meta, std::vector<ImageView>* blobs);
+
+}  // namespace hal
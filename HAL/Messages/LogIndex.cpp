@@ -0,0 +1,391 @@
+#include <HAL/Messages/LogIndex.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <glog/logging.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/wire_format_lite.h>
+
+namespace hal {
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::internal::WireFormatLite;
+
+namespace {
+
+/// Block size used when scanning framing. Most of each record is
+/// skipped with lseek, so there is no point in reading ahead much.
+const int kScanBlockSize = 1 << 16;
+
+bool ReadFully(int fd, void* buf, size_t len, off_t offset) {
+  char* dst = static_cast<char*>(buf);
+  while (len > 0) {
+    ssize_t n = pread(fd, dst, len, offset);
+    if (n <= 0) {
+      return false;
+    }
+    dst += n;
+    len -= n;
+    offset += n;
+  }
+  return true;
+}
+
+/// IsZeroFilledTail() for the bytes of `fd` from `offset` to `end`.
+bool IsZeroFilledTail(int fd, off_t offset, off_t end) {
+  std::vector<char> block(kScanBlockSize);
+  while (offset < end) {
+    const size_t len = std::min<off_t>(end - offset, block.size());
+    if (!ReadFully(fd, block.data(), len, offset) ||
+        !hal::IsZeroFilledTail(block.data(), len)) {
+      return false;
+    }
+    offset += len;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool ReadLogHeader(google::protobuf::io::ZeroCopyInputStream* input,
+                   hal::Header* header) {
+  CodedInputStream coded_input(input);
+
+  char magic_number[4];
+  if (!coded_input.ReadRaw(magic_number, 4) ||
+      magic_number[0] != '%' || magic_number[1] != 'H' ||
+      magic_number[2] != 'A' || magic_number[3] != 'L') {
+    return false;
+  }
+
+  uint32_t hdr_size_bytes;
+  if (!coded_input.ReadVarint32(&hdr_size_bytes)) {
+    return false;
+  }
+
+  if (header == nullptr) {
+    return coded_input.Skip(hdr_size_bytes);
+  }
+
+  CodedInputStream::Limit lim = coded_input.PushLimit(hdr_size_bytes);
+  if (!header->ParseFromCodedStream(&coded_input)) {
+    return false;
+  }
+  coded_input.PopLimit(lim);
+  return true;
+}
+
+bool ReadLogRecordInfo(CodedInputStream* input, uint32_t size,
+                       LogIndexEntry* entry) {
+  entry->timestamp = 0;
+  entry->type = 0;
+  entry->id = -1;
+
+  CodedInputStream::Limit lim = input->PushLimit(size);
+  while (uint32_t tag = input->ReadTag()) {
+    const uint32_t field = WireFormatLite::GetTagFieldNumber(tag);
+    const WireFormatLite::WireType wire_type =
+        WireFormatLite::GetTagWireType(tag);
+
+    if (field == hal::Msg::kTimestampFieldNumber &&
+        wire_type == WireFormatLite::WIRETYPE_FIXED64) {
+      uint64_t bits;
+      if (!input->ReadLittleEndian64(&bits)) {
+        return false;
+      }
+      std::memcpy(&entry->timestamp, &bits, sizeof(bits));
+    } else if (field == hal::Msg::kBlobFieldNumber ||
+               field == hal::Msg::kBlobPaddingFieldNumber) {
+      // Out of band image data of the payload, not a payload itself.
+      if (!WireFormatLite::SkipField(input, tag)) {
+        return false;
+      }
+    } else if (wire_type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+      // Every payload of hal::Msg is a sub-message. Its id, when it has
+      // one, is field 1 and is serialized first.
+      uint32_t length;
+      if (!input->ReadVarint32(&length)) {
+        return false;
+      }
+      entry->type = field;
+
+      CodedInputStream::Limit sub = input->PushLimit(length);
+      const uint32_t sub_tag = input->ReadTag();
+      if (WireFormatLite::GetTagFieldNumber(sub_tag) == 1 &&
+          WireFormatLite::GetTagWireType(sub_tag) ==
+          WireFormatLite::WIRETYPE_VARINT) {
+        uint32_t id;
+        if (!input->ReadVarint32(&id)) {
+          return false;
+        }
+        entry->id = static_cast<int32_t>(id);
+      } else if (sub_tag != 0 && !WireFormatLite::SkipField(input, sub_tag)) {
+        return false;
+      }
+      if (!input->Skip(input->BytesUntilLimit())) {
+        return false;
+      }
+      input->PopLimit(sub);
+    } else if (!WireFormatLite::SkipField(input, tag)) {
+      return false;
+    }
+  }
+
+  // ReadTag() also returns 0 when the file ends early.
+  const bool complete = input->BytesUntilLimit() == 0;
+  input->PopLimit(lim);
+  return complete;
+}
+
+void GetLogPayload(const hal::Msg& msg, uint32_t* type, int32_t* id) {
+  *type = 0;
+  *id = -1;
+  if (msg.has_camera()) {
+    *type = hal::Msg::kCameraFieldNumber;
+    *id = msg.camera().has_id() ? msg.camera().id() : -1;
+  } else if (msg.has_imu()) {
+    *type = hal::Msg::kImuFieldNumber;
+    *id = msg.imu().has_id() ? msg.imu().id() : -1;
+  } else if (msg.has_pose()) {
+    *type = hal::Msg::kPoseFieldNumber;
+    *id = msg.pose().has_id() ? msg.pose().id() : -1;
+  } else if (msg.has_lidar()) {
+    *type = hal::Msg::kLidarFieldNumber;
+    *id = msg.lidar().has_id() ? msg.lidar().id() : -1;
+  } else if (msg.has_gamepad()) {
+    *type = hal::Msg::kGamepadFieldNumber;
+    *id = msg.gamepad().has_device_id() ? msg.gamepad().device_id() : -1;
+  } else if (msg.has_command()) {
+    *type = hal::Msg::kCommandFieldNumber;
+    *id = msg.command().worldid();
+  } else if (msg.has_vehicle_state()) {
+    *type = hal::Msg::kVehicleStateFieldNumber;
+  }
+}
+
+void LogIndex::Add(uint64_t offset, const hal::Msg& msg) {
+  LogIndexEntry entry;
+  entry.offset = offset;
+  entry.timestamp = msg.timestamp();
+  GetLogPayload(msg, &entry.type, &entry.id);
+  m_vEntries.push_back(entry);
+}
+
+size_t LogIndex::FindTime(double dTime) const {
+  for (size_t ii = 0; ii < m_vEntries.size(); ++ii) {
+    if (m_vEntries[ii].timestamp >= dTime) {
+      return ii;
+    }
+  }
+  return m_vEntries.size();
+}
+
+void LogIndex::ToMsg(hal::LogIndexMsg* msg) const {
+  msg->Clear();
+  msg->mutable_offset()->Reserve(m_vEntries.size());
+  msg->mutable_timestamp()->Reserve(m_vEntries.size());
+  msg->mutable_type()->Reserve(m_vEntries.size());
+  msg->mutable_id()->Reserve(m_vEntries.size());
+  for (const LogIndexEntry& entry : m_vEntries) {
+    msg->add_offset(entry.offset);
+    msg->add_timestamp(entry.timestamp);
+    msg->add_type(entry.type);
+    msg->add_id(entry.id);
+  }
+}
+
+void LogIndex::FromMsg(const hal::LogIndexMsg& msg) {
+  const int size = msg.offset_size();
+  if (msg.timestamp_size() != size || msg.type_size() != size ||
+      msg.id_size() != size) {
+    LOG(ERROR) << "HAL: Log index columns differ in length. Ignoring index.";
+    m_vEntries.clear();
+    return;
+  }
+
+  m_vEntries.resize(size);
+  for (int ii = 0; ii < size; ++ii) {
+    m_vEntries[ii].offset = msg.offset(ii);
+    m_vEntries[ii].timestamp = msg.timestamp(ii);
+    m_vEntries[ii].type = msg.type(ii);
+    m_vEntries[ii].id = msg.id(ii);
+  }
+}
+
+bool LogIndex::Load(const std::string& sFilename) {
+  Clear();
+
+  int fd = open(sFilename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    LOG(ERROR) << "HAL: File '" << sFilename << "' could not be opened.";
+    return false;
+  }
+
+  struct stat st;
+  unsigned char trailer_bytes[kLogTrailerSize];
+  hal::Msg trailer;
+  bool ok = fstat(fd, &st) == 0 &&
+      st.st_size > static_cast<off_t>(kLogTrailerSize) &&
+      ReadFully(fd, trailer_bytes, kLogTrailerSize,
+                st.st_size - kLogTrailerSize) &&
+      trailer_bytes[0] == kLogTrailerSize - 1 &&
+      trailer.ParseFromArray(trailer_bytes + 1, kLogTrailerSize - 1) &&
+      trailer.has_trailer() &&
+      trailer.trailer().magic() == kLogIndexMagic;
+
+  // The index record spans from its offset up to the trailer.
+  const uint64_t index_offset = ok ? trailer.trailer().index_offset() : 0;
+  const uint64_t index_end = ok ? st.st_size - kLogTrailerSize : 0;
+  ok = ok && index_offset < index_end;
+
+  std::string record;
+  if (ok) {
+    record.resize(index_end - index_offset);
+    ok = ReadFully(fd, &record[0], record.size(), index_offset);
+  }
+  close(fd);
+
+  if (!ok) {
+    return false;
+  }
+
+  CodedInputStream coded_input(
+      reinterpret_cast<const uint8_t*>(record.data()), record.size());
+  uint32_t msg_size_bytes;
+  hal::Msg msg;
+  if (!coded_input.ReadVarint32(&msg_size_bytes) ||
+      msg_size_bytes !=
+      static_cast<uint32_t>(coded_input.BytesUntilLimit()) ||
+      !msg.ParseFromCodedStream(&coded_input) || !msg.has_index()) {
+    LOG(ERROR) << "HAL: Log '" << sFilename << "' has a corrupt index.";
+    return false;
+  }
+
+  FromMsg(msg.index());
+  return !Empty();
+}
+
+bool IsZeroFilledTail(const void* data, size_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  return std::all_of(bytes, bytes + size, [](char c) { return c == 0; });
+}
+
+bool LogIndex::Rebuild(const std::string& sFilename, uint64_t* pEnd) {
+  Clear();
+
+  int fd = open(sFilename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    LOG(ERROR) << "HAL: File '" << sFilename << "' could not be opened.";
+    return false;
+  }
+
+  // Skipping uses lseek, which happily moves past the end of file, so
+  // truncation is detected against the file size.
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  const uint64_t file_size = st.st_size;
+
+  google::protobuf::io::FileInputStream raw_input(fd, kScanBlockSize);
+  raw_input.SetCloseOnDelete(true);
+
+  if (!ReadLogHeader(&raw_input, nullptr)) {
+    LOG(ERROR) << "HAL: File '" << sFilename << "' is not a HAL log.";
+    return false;
+  }
+
+  uint64_t offset = raw_input.ByteCount();
+  while (true) {
+    // A fresh CodedInputStream per record keeps clear of its 2 GB
+    // total bytes limit.
+    CodedInputStream coded_input(&raw_input);
+
+    uint32_t msg_size_bytes;
+    if (!coded_input.ReadVarint32(&msg_size_bytes)) {
+      break;
+    }
+
+    const uint64_t next_offset = offset +
+        CodedOutputStream::VarintSize32(msg_size_bytes) + msg_size_bytes;
+
+    LogIndexEntry entry;
+    entry.offset = offset;
+    if (next_offset > file_size ||
+        !ReadLogRecordInfo(&coded_input, msg_size_bytes, &entry)) {
+      LOG(WARNING) << "HAL: Log '" << sFilename
+                   << "' ends in a truncated record at byte " << offset;
+      break;
+    }
+
+    if (IsLogFooter(entry)) {
+      break;
+    }
+
+    if (msg_size_bytes == 0 && IsZeroFilledTail(fd, offset, file_size)) {
+      LOG(WARNING) << "HAL: Log '" << sFilename
+                   << "' ends in zeros at byte " << offset;
+      break;
+    }
+
+    m_vEntries.push_back(entry);
+    offset = next_offset;
+  }
+
+  if (pEnd) {
+    *pEnd = offset;
+  }
+  return true;
+}
+
+bool LogIndex::Append(const std::string& sFilename) const {
+  int fd = open(sFilename.c_str(), O_WRONLY);
+  if (fd == -1) {
+    LOG(ERROR) << "HAL: File '" << sFilename << "' could not be opened.";
+    return false;
+  }
+
+  const off_t offset = lseek(fd, 0, SEEK_END);
+  if (offset == -1) {
+    close(fd);
+    return false;
+  }
+
+  google::protobuf::io::FileOutputStream raw_output(fd);
+  bool ok;
+  {
+    CodedOutputStream coded_output(&raw_output);
+    ok = WriteFooter(&coded_output, offset);
+  }
+  return raw_output.Close() && ok;
+}
+
+bool LogIndex::WriteFooter(CodedOutputStream* output, uint64_t nOffset) const {
+  hal::Msg msg;
+  ToMsg(msg.mutable_index());
+  output->WriteVarint32(msg.ByteSize());
+  if (!msg.SerializeToCodedStream(output)) {
+    LOG(ERROR) << "HAL: Failed to serialize log index.";
+    return false;
+  }
+
+  msg.Clear();
+  msg.mutable_trailer()->set_index_offset(nOffset);
+  msg.mutable_trailer()->set_magic(kLogIndexMagic);
+  CHECK_EQ(msg.ByteSize() + 1, static_cast<int>(kLogTrailerSize));
+  output->WriteVarint32(msg.ByteSize());
+  return msg.SerializeToCodedStream(output);
+}
+
+}  // namespace hal
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <HAL/Header.pb.h>
+#include <HAL/Messages.pb.h>
+
+namespace google {
+namespace protobuf {
+namespace io {
+class CodedInputStream;
+class CodedOutputStream;
+class ZeroCopyInputStream;
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+namespace hal {
+
+/// Size in bytes of the trailer record that closes an indexed log.
+const size_t kLogTrailerSize = 17;
+
+/// "%IDX" stored little-endian in LogTrailerMsg.magic.
+const uint32_t kLogIndexMagic = 0x58444925;
+
+/// One record of a log, as stored in its seek index.
+struct LogIndexEntry {
+  LogIndexEntry() : offset(0), timestamp(0), type(0), id(-1) {}
+
+  /// Byte offset of the record's size prefix from the start of the file.
+  uint64_t offset;
+
+  /// hal::Msg timestamp of the record.
+  double   timestamp;
+
+  /// Field number of the payload set in hal::Msg, 0 if none is set.
+  uint32_t type;
+
+  /// Id of the payload (camera id, imu id, ...), -1 if it has none.
+  int32_t  id;
+};
+
+/// Reads past the magic number and Header message at the start of a
+/// log. `header` may be null if the caller does not need it.
+///
+/// Returns false if the stream is not a HAL log.
+bool ReadLogHeader(google::protobuf::io::ZeroCopyInputStream* input,
+                   hal::Header* header);
+
+/// Fills `entry` from a serialized hal::Msg of `size` bytes at the
+/// current position of `input` without parsing its payload: only the
+/// timestamp, the payload field number and the payload id are decoded
+/// and everything else is skipped. `entry->offset` is left untouched.
+///
+/// Returns false if the record is truncated or malformed.
+bool ReadLogRecordInfo(google::protobuf::io::CodedInputStream* input,
+                       uint32_t size, LogIndexEntry* entry);
+
+/// Field number of the payload set in `msg` (0 if none) and the id of
+/// that payload (-1 if it has none).
+void GetLogPayload(const hal::Msg& msg, uint32_t* type, int32_t* id);
+
+/// True if the `size` bytes at `data` are all zero. A log ends where
+/// an empty record is followed by nothing but zeros: the tail a file
+/// system may leave at the end of a file after a power loss. Any other
+/// empty record is a hal::Msg without a payload.
+bool IsZeroFilledTail(const void* data, size_t size);
+
+/// True for the index and trailer records that close an indexed log.
+inline bool IsLogFooter(const LogIndexEntry& entry) {
+  return entry.type == hal::Msg::kIndexFieldNumber ||
+      entry.type == hal::Msg::kTrailerFieldNumber;
+}
+
+/**
+ * Seek index of a HAL log.
+ *
+ * hal::Logger appends the index as a footer to every log it closes:
+ * a record holding a LogIndexMsg followed by a fixed size record
+ * holding a LogTrailerMsg that points back to it. Both are ordinary
+ * hal::Msg records, so readers which don't know about the index just
+ * see two messages without sensor data at the end of the log.
+ *
+ * Logs written before the index existed (or whose logger died before
+ * closing them) can be indexed with Rebuild(), which only walks the
+ * record framing, and then Append() to store the result.
+ */
+class LogIndex {
+ public:
+  /// Add a record which was written at `offset`.
+  void Add(uint64_t offset, const hal::Msg& msg);
+  void Add(const LogIndexEntry& entry) { m_vEntries.push_back(entry); }
+
+  void Clear() { m_vEntries.clear(); }
+  size_t Size() const { return m_vEntries.size(); }
+  bool Empty() const { return m_vEntries.empty(); }
+
+  const LogIndexEntry& operator[](size_t idx) const {
+    return m_vEntries[idx];
+  }
+
+  /// Position of the first record stamped at or after `dTime`, or
+  /// Size() if there is none.
+  size_t FindTime(double dTime) const;
+
+  void ToMsg(hal::LogIndexMsg* msg) const;
+  void FromMsg(const hal::LogIndexMsg& msg);
+
+  /// Load the index stored at the end of the given log. Returns false
+  /// if the log has no index footer.
+  bool Load(const std::string& sFilename);
+
+  /// Rebuild the index by scanning the framing of the given log. Stops
+  /// at the first truncated record, at a zero-filled tail (see
+  /// IsZeroFilledTail()) or at an index footer. Returns false if the
+  /// file can't be opened or is not a HAL log.
+  ///
+  /// `pEnd`, if given, is set to the end of the last record indexed,
+  /// where the log can be cut to drop a truncated tail.
+  bool Rebuild(const std::string& sFilename, uint64_t* pEnd = nullptr);
+
+  /// Append this index as a footer to the given log, which must not
+  /// already have one.
+  bool Append(const std::string& sFilename) const;
+
+  /// Write the index and trailer records, with the index starting at
+  /// `nOffset` in the output file.
+  bool WriteFooter(google::protobuf::io::CodedOutputStream* output,
+                   uint64_t nOffset) const;
+
+ private:
+  std::vector<LogIndexEntry> m_vEntries;
+};
+
+}  // namespace hal
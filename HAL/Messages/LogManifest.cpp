@@ -0,0 +1,128 @@
+#include <HAL/Messages/LogManifest.h>
+
+#include <stdio.h>
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <glog/logging.h>
+#include <google/protobuf/text_format.h>
+
+namespace hal {
+
+namespace {
+
+const char kManifestComment[] = "# HAL log manifest\n";
+
+/// Position just past the last '/' of a path, 0 if there is none.
+size_t BasenamePos(const std::string& sPath) {
+  const size_t pos = sPath.find_last_of('/');
+  return pos == std::string::npos ? 0 : pos + 1;
+}
+
+}  // namespace
+
+bool LogManifest::IsManifest(const std::string& sFilename) {
+  std::ifstream file(sFilename, std::ios::binary);
+  char magic_number[4];
+  if (!file.read(magic_number, 4) ||
+      (magic_number[0] == '%' && magic_number[1] == 'H' &&
+       magic_number[2] == 'A' && magic_number[3] == 'L')) {
+    return false;
+  }
+
+  LogManifest manifest;
+  return manifest.Load(sFilename);
+}
+
+std::string LogManifest::SegmentFilename(const std::string& sFilename,
+                                         size_t nSegment) {
+  size_t ext = sFilename.find_last_of('.');
+  if (ext == std::string::npos || ext < BasenamePos(sFilename)) {
+    ext = sFilename.size();
+  }
+
+  std::stringstream ss;
+  ss << sFilename.substr(0, ext) << "_" << std::setw(4) << std::setfill('0')
+     << nSegment << sFilename.substr(ext);
+  return ss.str();
+}
+
+bool LogManifest::Load(const std::string& sFilename) {
+  std::ifstream file(sFilename, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  std::stringstream ss;
+  ss << file.rdbuf();
+  m_Msg.Clear();
+  if (!google::protobuf::TextFormat::ParseFromString(ss.str(), &m_Msg)) {
+    m_Msg.Clear();
+    return false;
+  }
+
+  m_sDirectory = sFilename.substr(0, BasenamePos(sFilename));
+  return true;
+}
+
+bool LogManifest::Save(const std::string& sFilename) const {
+  std::string sText;
+  if (!google::protobuf::TextFormat::PrintToString(m_Msg, &sText)) {
+    return false;
+  }
+
+  const std::string sTemp = sFilename + ".tmp";
+  {
+    std::ofstream file(sTemp, std::ios::binary | std::ios::trunc);
+    file << kManifestComment << sText;
+    if (!file.flush()) {
+      LOG(ERROR) << "HAL: Failed to write manifest " << sTemp << ".";
+      return false;
+    }
+  }
+
+  if (rename(sTemp.c_str(), sFilename.c_str()) != 0) {
+    LOG(ERROR) << "HAL: Failed to replace manifest " << sFilename << ".";
+    return false;
+  }
+  return true;
+}
+
+hal::LogSegmentMsg* LogManifest::Add(const std::string& sFilename) {
+  hal::LogSegmentMsg* pSegment = m_Msg.add_segment();
+  pSegment->set_filename(sFilename.substr(BasenamePos(sFilename)));
+  return pSegment;
+}
+
+std::string LogManifest::SegmentPath(size_t idx) const {
+  return m_sDirectory + m_Msg.segment(idx).filename();
+}
+
+bool LogManifest::FindMessage(size_t nMsgID, size_t* pSegment,
+                              size_t* pLocalID) const {
+  for (int ii = 0; ii < m_Msg.segment_size(); ++ii) {
+    const hal::LogSegmentMsg& segment = m_Msg.segment(ii);
+    // A segment still being written holds everything past the others.
+    if (!segment.has_num_messages() || nMsgID < segment.num_messages()) {
+      *pSegment = ii;
+      *pLocalID = nMsgID;
+      return true;
+    }
+    nMsgID -= segment.num_messages();
+  }
+  return false;
+}
+
+size_t LogManifest::FindTime(double dTime) const {
+  for (int ii = 0; ii < m_Msg.segment_size(); ++ii) {
+    const hal::LogSegmentMsg& segment = m_Msg.segment(ii);
+    if (!segment.has_end_time() || segment.end_time() >= dTime) {
+      return ii;
+    }
+  }
+  return m_Msg.segment_size();
+}
+
+}  // namespace hal
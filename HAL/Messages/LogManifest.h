@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <string>
+
+#include <HAL/LogIndex.pb.h>
+
+namespace hal {
+
+/**
+ * Manifest of a log which hal::Logger split into segments.
+ *
+ * A small text file (a LogManifestMsg in protobuf text format) listing
+ * the segment files in the order they were written, along with the
+ * time range and size of each. Segment filenames are relative to the
+ * directory of the manifest. hal::Reader replays the segments of a
+ * manifest as one continuous log.
+ *
+ * The logger rewrites the manifest whenever it starts or closes a
+ * segment, so a manifest can be read while its log is being written.
+ * The last segment then has no time range or message count yet.
+ */
+class LogManifest {
+ public:
+  /// True if the file is a manifest rather than a log.
+  static bool IsManifest(const std::string& sFilename);
+
+  /// Name of segment `nSegment` of a log written to `sFilename`:
+  /// "dir/run.log" becomes "dir/run_0003.log".
+  static std::string SegmentFilename(const std::string& sFilename,
+                                     size_t nSegment);
+
+  /// Returns false if the file can't be read or is not a manifest.
+  bool Load(const std::string& sFilename);
+
+  /// Write to a temporary file renamed over `sFilename`, so readers
+  /// never see a partial manifest.
+  bool Save(const std::string& sFilename) const;
+
+  size_t Size() const { return m_Msg.segment_size(); }
+  bool Empty() const { return m_Msg.segment_size() == 0; }
+
+  const hal::LogSegmentMsg& operator[](size_t idx) const {
+    return m_Msg.segment(idx);
+  }
+  hal::LogSegmentMsg* Mutable(size_t idx) {
+    return m_Msg.mutable_segment(idx);
+  }
+
+  /// Append a segment. Segments live next to their manifest, so only
+  /// the last component of `sFilename` is recorded.
+  hal::LogSegmentMsg* Add(const std::string& sFilename);
+
+  /// Path of a segment file, resolved against the directory the
+  /// manifest was loaded from.
+  std::string SegmentPath(size_t idx) const;
+
+  /// Segment holding message `nMsgID`, counting messages across all
+  /// segments, and the position of the message within that segment.
+  /// Returns false if the log ends before it.
+  bool FindMessage(size_t nMsgID, size_t* pSegment, size_t* pLocalID) const;
+
+  /// First segment with messages stamped at or after `dTime`, or
+  /// Size() if there is none.
+  size_t FindTime(double dTime) const;
+
+ private:
+  hal::LogManifestMsg m_Msg;
+  std::string         m_sDirectory;  // With a trailing '/', or empty.
+};
+
+}  // namespace hal
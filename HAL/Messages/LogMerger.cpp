@@ -0,0 +1,91 @@
+#include <HAL/Messages/LogMerger.h>
+
+#include <limits>
+
+#include <HAL/Messages/Logger.h>
+
+namespace hal {
+
+LogMerger::LogMerger(const std::vector<std::string>& vFilenames,
+                     MergeOrder eOrder)
+    : m_eOrder(eOrder), m_bStarted(false) {
+  // Readers of their own rather than shared ones: a log listed twice is
+  // merged twice.
+  for (const std::string& sFilename : vFilenames) {
+    m_vReaders.emplace_back(new hal::Reader(sFilename));
+    m_vReaders.back()->EnableAll();
+  }
+}
+
+void LogMerger::SetMemoryMapped(bool bMemoryMapped) {
+  for (const std::unique_ptr<hal::Reader>& pReader : m_vReaders) {
+    pReader->SetMemoryMapped(bMemoryMapped);
+  }
+}
+
+double LogMerger::MessageTime(const hal::Msg& msg, MergeOrder eOrder) {
+  if (eOrder == Merge_DeviceTime) {
+    if (msg.has_camera() && msg.camera().has_device_time()) {
+      return msg.camera().device_time();
+    } else if (msg.has_imu() && msg.imu().has_device_time()) {
+      return msg.imu().device_time();
+    } else if (msg.has_lidar() && msg.lidar().has_device_time()) {
+      return msg.lidar().device_time();
+    } else if (msg.has_pose() && msg.pose().has_device_time()) {
+      return msg.pose().device_time();
+    }
+  }
+  // Messages without a time go first rather than being held back.
+  return msg.has_timestamp() ? msg.timestamp() :
+      -std::numeric_limits<double>::infinity();
+}
+
+void LogMerger::_ReadHead(size_t nLog) {
+  std::shared_ptr<hal::Msg> pMsg = m_vReaders[nLog]->ReadMessage();
+  if (pMsg) {
+    Head head;
+    head.time = MessageTime(*pMsg, m_eOrder);
+    head.log = nLog;
+    head.msg = std::move(pMsg);
+    m_Heads.push(std::move(head));
+  }
+}
+
+std::shared_ptr<hal::Msg> LogMerger::ReadMessage(size_t* pLog) {
+  if (!m_bStarted) {
+    m_bStarted = true;
+    for (size_t ii = 0; ii < m_vReaders.size(); ++ii) {
+      _ReadHead(ii);
+    }
+  }
+
+  if (m_Heads.empty()) {
+    return nullptr;
+  }
+
+  Head next = m_Heads.top();
+  m_Heads.pop();
+  _ReadHead(next.log);
+
+  if (pLog) {
+    *pLog = next.log;
+  }
+  return next.msg;
+}
+
+size_t LogMerger::MergeInto(hal::Logger* pLogger) {
+  // Block for as long as a stalled disk might take, a day, rather than
+  // drop messages.
+  pLogger->SetBackpressurePolicy(hal::Logger::Backpressure_Block);
+  pLogger->SetBlockTimeout(24 * 3600.0);
+
+  size_t nMerged = 0;
+  while (std::shared_ptr<hal::Msg> pMsg = ReadMessage()) {
+    if (pLogger->LogMessage(std::move(*pMsg))) {
+      ++nMerged;
+    }
+  }
+  return nMerged;
+}
+
+}  // namespace hal
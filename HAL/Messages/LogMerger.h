@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <HAL/Messages.pb.h>
+#include <HAL/Messages/Reader.h>
+
+namespace hal {
+
+class Logger;
+
+/**
+ * Merges several logs, e.g. recorded on different machines, into one
+ * stream of messages ordered by time.
+ *
+ * Each log is replayed by its own hal::Reader and only the next message
+ * of every log is held for merging, so memory stays bounded by the
+ * readers' queues no matter how long the logs are. Each log is taken to
+ * be in order already; a message out of order within its log is merged
+ * where it is read. Messages with equal times keep the order of the
+ * logs they come from.
+ *
+ * Only the message types hal::Reader replays (camera, IMU, LIDAR and
+ * pose) are merged.
+ */
+class LogMerger {
+ public:
+  /** Time messages are ordered by. */
+  enum MergeOrder {
+    /// hal::Msg::timestamp, the time the message was logged.
+    Merge_Timestamp,
+    /// device_time of the camera, IMU, LIDAR or pose message, falling
+    /// back to the timestamp for messages without one.
+    Merge_DeviceTime
+  };
+
+  LogMerger(const std::vector<std::string>& vFilenames,
+            MergeOrder eOrder = Merge_Timestamp);
+
+  /** Read the logs through memory mappings (see hal::Reader). Must be
+   * called before the first read. */
+  void SetMemoryMapped(bool bMemoryMapped);
+
+  /** The next message of all logs, null once every log has ended.
+   * `pLog`, if given, is set to the index of the log it came from. */
+  std::shared_ptr<hal::Msg> ReadMessage(size_t* pLog = nullptr);
+
+  /** Log every remaining message, in order, with a logger which has
+   * been started. Waits for the logger rather than dropping messages.
+   * Returns the number of messages handed to the logger. */
+  size_t MergeInto(hal::Logger* pLogger);
+
+  size_t NumLogs() const { return m_vReaders.size(); }
+
+  /** Time of a message under the given order. */
+  static double MessageTime(const hal::Msg& msg, MergeOrder eOrder);
+
+ private:
+  /** Next message of a log waiting to be merged. */
+  struct Head {
+    double                    time;
+    size_t                    log;
+    std::shared_ptr<hal::Msg> msg;
+  };
+
+  /** Orders the heap by earliest time, then lowest log index. */
+  struct Later {
+    bool operator()(const Head& lhs, const Head& rhs) const {
+      return lhs.time > rhs.time ||
+          (lhs.time == rhs.time && lhs.log > rhs.log);
+    }
+  };
+
+  /** Read the next message of a log into the heap, if it has one. */
+  void _ReadHead(size_t nLog);
+
+ private:
+  std::vector<std::unique_ptr<hal::Reader>>            m_vReaders;
+  std::priority_queue<Head, std::vector<Head>, Later>  m_Heads;
+  MergeOrder                                           m_eOrder;
+  bool                                                 m_bStarted;
+};
+
+}  // namespace hal
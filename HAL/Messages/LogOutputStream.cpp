@@ -0,0 +1,444 @@
+#include <HAL/Messages/LogOutputStream.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include <glog/logging.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+namespace hal {
+
+namespace {
+
+double Now() {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+size_t RoundUp(size_t n, size_t alignment) {
+  return (n + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+LogOutputStream::LogOutputStream(const LogWriterOptions& options)
+    : m_Options(options), m_nInFlight(0), m_pRing(nullptr), m_nFull(0),
+      m_nUsed(0), m_nFd(-1), m_bDirect(false), m_bError(false), m_nFileOffset(0),
+      m_nPreallocated(0), m_nUnsynced(0), m_dLastSync(0) {
+  // posix_memalign() wants a power of two multiple of sizeof(void*).
+  size_t alignment = sizeof(void*);
+  while (alignment < m_Options.alignment) {
+    alignment <<= 1;
+  }
+  m_Options.alignment = alignment;
+  m_Options.block_size = RoundUp(
+      std::min<size_t>(std::max<size_t>(m_Options.block_size, 1), INT_MAX / 2),
+      alignment);
+  m_Options.num_blocks = std::min<size_t>(
+      std::max<size_t>(m_Options.num_blocks, m_Options.async_io ? 2 : 1),
+      IOV_MAX);
+}
+
+LogOutputStream::~LogOutputStream() {
+  Close();
+  for (unsigned char* pBuffer : m_vBuffers) {
+    free(pBuffer);
+  }
+}
+
+bool LogOutputStream::Open(const std::string& sFilename) {
+  Close();
+
+  m_sFilename = sFilename;
+  m_nFull = m_nUsed = 0;
+  m_bError = false;
+  m_nFileOffset = m_nPreallocated = m_nUnsynced = 0;
+  m_dLastSync = Now();
+
+  while (m_vBuffers.size() < m_Options.num_blocks) {
+    void* pBuffer = nullptr;
+    if (posix_memalign(&pBuffer, m_Options.alignment,
+                       m_Options.block_size) != 0) {
+      LOG(ERROR) << "HAL: Could not allocate log write buffers.";
+      return false;
+    }
+    m_vBuffers.push_back(static_cast<unsigned char*>(pBuffer));
+  }
+
+  const mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+  const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+  m_bDirect = false;
+#ifdef O_DIRECT
+  if (m_Options.direct_io) {
+    m_nFd = open(sFilename.c_str(), flags | O_DIRECT, mode);
+    m_bDirect = (m_nFd != -1);
+    if (!m_bDirect) {
+      LOG(WARNING) << "HAL: O_DIRECT not available for " << sFilename
+                   << " (" << strerror(errno) << "), using buffered IO.";
+    }
+  }
+#else
+  LOG_IF(WARNING, m_Options.direct_io)
+      << "HAL: O_DIRECT is not supported on this platform.";
+#endif
+  if (m_nFd == -1) {
+    m_nFd = open(sFilename.c_str(), flags, mode);
+  }
+  if (m_nFd == -1) {
+    LOG(ERROR) << "HAL: Error opening file " << sFilename << ": "
+               << strerror(errno);
+    return false;
+  }
+
+  if (m_Options.async_io) {
+#ifdef HAVE_LIBURING
+    m_pRing = new io_uring;
+    const int result = io_uring_queue_init(m_Options.num_blocks, m_pRing, 0);
+    if (result < 0) {
+      LOG(WARNING) << "HAL: io_uring not available (" << strerror(-result)
+                   << "), using synchronous writes.";
+      delete m_pRing;
+      m_pRing = nullptr;
+    }
+#else
+    LOG(WARNING) << "HAL: Built without io_uring, using synchronous writes.";
+#endif
+  }
+
+  // Async mode fills one buffer at a time, the others are in flight or
+  // spare.
+  m_vBlocks.assign(m_vBuffers.begin(),
+                   m_pRing ? m_vBuffers.begin() + 1 : m_vBuffers.end());
+  m_vSpare.assign(m_vBuffers.begin() + m_vBlocks.size(), m_vBuffers.end());
+  m_vPending.assign(m_vSpare.size(), PendingWrite());
+  m_nInFlight = 0;
+  return true;
+}
+
+bool LogOutputStream::Close() {
+  if (m_nFd == -1) {
+    return !m_bError;
+  }
+
+  // O_DIRECT can't write the unaligned end of the file.
+  if (m_bDirect && m_nUsed % m_Options.alignment != 0) {
+    fcntl(m_nFd, F_SETFL, fcntl(m_nFd, F_GETFL) & ~O_DIRECT);
+    m_bDirect = false;
+  }
+  WriteBuffers(true);
+
+  if (m_nPreallocated > m_nFileOffset &&
+      ftruncate(m_nFd, m_nFileOffset) != 0) {
+    LOG(WARNING) << "HAL: Could not trim " << m_sFilename << ": "
+                 << strerror(errno);
+  }
+  if ((m_Options.sync_bytes > 0 || m_Options.sync_interval > 0) && !m_bError) {
+    Sync();
+  }
+  if (close(m_nFd) != 0) {
+    m_bError = true;
+  }
+  m_nFd = -1;
+
+#ifdef HAVE_LIBURING
+  if (m_pRing) {
+    io_uring_queue_exit(m_pRing);
+    delete m_pRing;
+    m_pRing = nullptr;
+  }
+#endif
+  return !m_bError;
+}
+
+bool LogOutputStream::Flush() {
+  return WriteBuffers(true);
+}
+
+bool LogOutputStream::Poll() {
+  if (m_Options.sync_interval <= 0 ||
+      Now() - m_dLastSync < m_Options.sync_interval) {
+    return !m_bError;
+  }
+  return Flush() && Sync();
+}
+
+bool LogOutputStream::Next(void** data, int* size) {
+  if (m_nFd == -1 || m_bError) {
+    return false;
+  }
+  if (m_nUsed == m_Options.block_size) {
+    if (m_pRing) {
+      if (!Submit()) {
+        return false;
+      }
+    } else {
+      ++m_nFull;
+      m_nUsed = 0;
+      if (m_nFull == m_vBlocks.size() && !WriteBuffers(false)) {
+        return false;
+      }
+    }
+  }
+  *data = m_vBlocks[m_nFull] + m_nUsed;
+  *size = static_cast<int>(m_Options.block_size - m_nUsed);
+  m_nUsed = m_Options.block_size;
+  return true;
+}
+
+void LogOutputStream::BackUp(int count) {
+  m_nUsed -= count;
+}
+
+int64_t LogOutputStream::ByteCount() const {
+  return m_nFileOffset + m_nFull * m_Options.block_size + m_nUsed;
+}
+
+bool LogOutputStream::WriteBuffers(bool bTail) {
+  // Whatever is left is written behind the writes in flight.
+  if (!Drain() || m_nFd == -1) {
+    return false;
+  }
+
+  const bool bHasCurrent = m_nFull < m_vBlocks.size();
+  size_t nTail = (bTail && bHasCurrent) ? m_nUsed : 0;
+  if (m_bDirect) {
+    nTail -= nTail % m_Options.alignment;
+  }
+
+  std::vector<struct iovec> iov;
+  iov.reserve(m_nFull + 1);
+  for (size_t ii = 0; ii < m_nFull; ++ii) {
+    iov.push_back({ m_vBlocks[ii], m_Options.block_size });
+  }
+  if (nTail > 0) {
+    iov.push_back({ m_vBlocks[m_nFull], nTail });
+  }
+  const uint64_t nTotal = m_nFull * m_Options.block_size + nTail;
+
+  Preallocate(m_nFileOffset + nTotal);
+
+  uint64_t offset = m_nFileOffset;
+  size_t idx = 0;
+  while (idx < iov.size()) {
+    const ssize_t written = pwritev(
+        m_nFd, &iov[idx], static_cast<int>(iov.size() - idx), offset);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(ERROR) << "HAL: Error writing " << m_sFilename << ": "
+                 << strerror(errno);
+      m_bError = true;
+      return false;
+    }
+    if (written == 0) {
+      LOG(ERROR) << "HAL: Error writing " << m_sFilename << ": "
+                 << strerror(EIO);
+      m_bError = true;
+      return false;
+    }
+    offset += written;
+    for (size_t left = written; left > 0 && idx < iov.size(); ) {
+      if (left >= iov[idx].iov_len) {
+        left -= iov[idx++].iov_len;
+      } else {
+        iov[idx].iov_base = static_cast<char*>(iov[idx].iov_base) + left;
+        iov[idx].iov_len -= left;
+        left = 0;
+      }
+    }
+  }
+  m_nFileOffset += nTotal;
+  m_nUnsynced += nTotal;
+
+  // Whatever was not written moves to the front of the first buffer.
+  if (bHasCurrent) {
+    const size_t nLeft = m_nUsed - nTail;
+    if (nTail > 0 && nLeft > 0) {
+      memmove(m_vBlocks[m_nFull], m_vBlocks[m_nFull] + nTail, nLeft);
+    }
+    std::swap(m_vBlocks[0], m_vBlocks[m_nFull]);
+    m_nUsed = nLeft;
+  } else {
+    m_nUsed = 0;
+  }
+  m_nFull = 0;
+
+  if (m_Options.sync_bytes > 0 && m_nUnsynced >= m_Options.sync_bytes) {
+    return Sync();
+  }
+  return true;
+}
+
+bool LogOutputStream::Preallocate(uint64_t nEnd) {
+  if (m_Options.preallocate_bytes == 0 || nEnd <= m_nPreallocated) {
+    return true;
+  }
+
+  const uint64_t nNewEnd = nEnd + m_Options.preallocate_bytes;
+#ifdef __linux__
+  // Keep the file size as is, so readers of a live log never see the
+  // reserved space.
+  if (fallocate(m_nFd, FALLOC_FL_KEEP_SIZE, m_nPreallocated,
+                nNewEnd - m_nPreallocated) == 0) {
+    m_nPreallocated = nNewEnd;
+    return true;
+  }
+  LOG(WARNING) << "HAL: Could not preallocate " << m_sFilename << ": "
+               << strerror(errno);
+#else
+  LOG(WARNING) << "HAL: Log preallocation is not supported on this platform.";
+#endif
+  m_Options.preallocate_bytes = 0;
+  return false;
+}
+
+bool LogOutputStream::Sync() {
+#ifdef __APPLE__
+  const int result = fsync(m_nFd);
+#else
+  const int result = fdatasync(m_nFd);
+#endif
+  if (result != 0) {
+    LOG(ERROR) << "HAL: Error syncing " << m_sFilename << ": "
+               << strerror(errno);
+    m_bError = true;
+    return false;
+  }
+  m_nUnsynced = 0;
+  m_dLastSync = Now();
+  return true;
+}
+
+bool LogOutputStream::Submit() {
+#ifdef HAVE_LIBURING
+  Preallocate(m_nFileOffset + m_Options.block_size);
+
+  while (m_vSpare.empty()) {
+    if (!Reap()) {
+      return false;
+    }
+  }
+
+  PendingWrite* pWrite = &*std::find_if(
+      m_vPending.begin(), m_vPending.end(),
+      [](const PendingWrite& w) { return w.data == nullptr; });
+  pWrite->data = m_vBlocks[0];
+  pWrite->size = m_Options.block_size;
+  pWrite->offset = m_nFileOffset;
+
+  // The ring has an entry per buffer, so one is always free here.
+  io_uring_sqe* sqe = io_uring_get_sqe(m_pRing);
+  io_uring_prep_write(sqe, m_nFd, pWrite->data, pWrite->size, pWrite->offset);
+  io_uring_sqe_set_data(sqe, pWrite);
+  const int result = io_uring_submit(m_pRing);
+  if (result < 0) {
+    LOG(ERROR) << "HAL: Error submitting write to " << m_sFilename << ": "
+               << strerror(-result);
+    pWrite->data = nullptr;
+    m_bError = true;
+    return false;
+  }
+  ++m_nInFlight;
+
+  m_vBlocks[0] = m_vSpare.back();
+  m_vSpare.pop_back();
+  m_nUsed = 0;
+  m_nFileOffset += m_Options.block_size;
+  m_nUnsynced += m_Options.block_size;
+
+  if (m_Options.sync_bytes > 0 && m_nUnsynced >= m_Options.sync_bytes) {
+    return Drain() && Sync();
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool LogOutputStream::Reap() {
+#ifdef HAVE_LIBURING
+  io_uring_cqe* cqe;
+  int result;
+  do {
+    result = io_uring_wait_cqe(m_pRing, &cqe);
+  } while (result == -EINTR);
+  if (result < 0) {
+    LOG(ERROR) << "HAL: Error waiting for writes to " << m_sFilename << ": "
+               << strerror(-result);
+    m_bError = true;
+    AbandonWrites();
+    return false;
+  }
+
+  PendingWrite* pWrite = static_cast<PendingWrite*>(io_uring_cqe_get_data(cqe));
+  result = cqe->res;
+  io_uring_cqe_seen(m_pRing, cqe);
+
+  // Finish short writes synchronously.
+  size_t done = result > 0 ? result : 0;
+  while (result >= 0 && done < pWrite->size) {
+    result = pwrite(m_nFd, pWrite->data + done, pWrite->size - done,
+                    pWrite->offset + done);
+    if (result > 0) {
+      done += result;
+    } else if (result < 0 && errno == EINTR) {
+      result = 0;
+    } else if (result < 0) {
+      result = -errno;
+    } else {
+      // Nothing written, nor an error to retry on: give up.
+      result = -EIO;
+    }
+  }
+  if (result < 0) {
+    LOG(ERROR) << "HAL: Error writing " << m_sFilename << ": "
+               << strerror(-result);
+    m_bError = true;
+  }
+
+  m_vSpare.push_back(pWrite->data);
+  pWrite->data = nullptr;
+  --m_nInFlight;
+  return !m_bError;
+#else
+  return false;
+#endif
+}
+
+bool LogOutputStream::Drain() {
+  // Keep reaping after a write error: the buffers must not be reused or
+  // freed while the kernel may still read them. Reap() gives up on all
+  // of them once the ring itself fails.
+  while (m_nInFlight > 0) {
+    Reap();
+  }
+  return !m_bError;
+}
+
+void LogOutputStream::AbandonWrites() {
+  // Leaked rather than freed: nothing tells when the kernel is done.
+  for (PendingWrite& write : m_vPending) {
+    if (write.data != nullptr) {
+      m_vBuffers.erase(std::find(m_vBuffers.begin(), m_vBuffers.end(),
+                                 write.data));
+      write.data = nullptr;
+    }
+  }
+  m_nInFlight = 0;
+}
+
+}  // namespace hal
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <google/protobuf/io/zero_copy_stream.h>
+
+struct io_uring;
+
+namespace hal {
+
+/// How hal::LogOutputStream lays out and pushes data to disk.
+struct LogWriterOptions {
+  LogWriterOptions()
+      : block_size(1 << 20), num_blocks(4), alignment(4096), direct_io(false),
+        preallocate_bytes(0), sync_bytes(0), sync_interval(0),
+        async_io(false) {}
+
+  /// Size of each write buffer, rounded up to `alignment`.
+  size_t   block_size;
+
+  /// Buffers gathered into one pwritev() call, or kept in flight at
+  /// once with `async_io`.
+  size_t   num_blocks;
+
+  /// Alignment of the buffers, and of writes when using O_DIRECT.
+  size_t   alignment;
+
+  /// Bypass the page cache. Falls back to buffered IO where the file
+  /// system does not support it.
+  bool     direct_io;
+
+  /// Reserve file extents this many bytes ahead of the data. 0 disables.
+  uint64_t preallocate_bytes;
+
+  /// fdatasync() once this many bytes were written since the last sync.
+  /// 0 disables.
+  uint64_t sync_bytes;
+
+  /// Write out buffered data and fdatasync() at least this often, in
+  /// seconds, as long as Poll() is called. 0 disables.
+  double   sync_interval;
+
+  /// Hand each buffer to io_uring as soon as it is full and keep
+  /// filling the next one while the kernel writes it. Only available
+  /// on Linux builds with liburing; falls back to pwritev() otherwise.
+  bool     async_io;
+};
+
+/**
+ * Zero copy output stream writing a file in large aligned batches.
+ *
+ * Data goes straight into a set of aligned buffers which are written
+ * with a single pwritev() once all of them are full, so a
+ * CodedOutputStream on top of this stream serializes without any
+ * intermediate copy. Extents can be preallocated ahead of the data and
+ * the file synced by size or time, see LogWriterOptions.
+ *
+ * In async mode each buffer is submitted to io_uring once it is full,
+ * and serialization carries on in one of the spare buffers.
+ */
+class LogOutputStream : public google::protobuf::io::ZeroCopyOutputStream {
+ public:
+  explicit LogOutputStream(const LogWriterOptions& options =
+                           LogWriterOptions());
+  ~LogOutputStream();
+
+  /// Create or truncate the file. Returns false on error.
+  bool Open(const std::string& sFilename);
+
+  /// Write out everything, trim preallocated space and close the file.
+  bool Close();
+
+  /// Write out all buffered data. With O_DIRECT an unaligned remainder
+  /// stays buffered until more data or Close() completes it.
+  bool Flush();
+
+  /// Flush and sync if the sync interval has passed. Cheap enough to
+  /// call whenever the writer runs out of data.
+  bool Poll();
+
+  bool IsOpen() const { return m_nFd != -1; }
+  bool IsAsync() const { return m_pRing != nullptr; }
+  bool HadError() const { return m_bError; }
+
+  /// Buffer alignment: LogWriterOptions::alignment rounded up to a
+  /// power of two no smaller than a pointer.
+  size_t alignment() const { return m_Options.alignment; }
+
+  /// Bytes handed to the kernel so far.
+  uint64_t bytes_written() const { return m_nFileOffset; }
+
+  // ZeroCopyOutputStream interface.
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  LogOutputStream(const LogOutputStream&) = delete;
+  LogOutputStream& operator=(const LogOutputStream&) = delete;
+
+  /// Write the full buffers and, if `bTail`, as much of the current one
+  /// as the IO mode allows.
+  bool WriteBuffers(bool bTail);
+  bool Preallocate(uint64_t nEnd);
+  bool Sync();
+
+  /// Async mode: submit the full current buffer and swap in a spare.
+  bool Submit();
+  /// Async mode: wait for a write to complete and recycle its buffer.
+  bool Reap();
+  /// Async mode: wait for all writes in flight.
+  bool Drain();
+  /// Async mode: forget the writes in flight once their completions
+  /// can't be waited for. Their buffers are never reused nor freed.
+  void AbandonWrites();
+
+ private:
+  struct PendingWrite {
+    unsigned char* data;
+    size_t         size;
+    uint64_t       offset;
+  };
+
+  LogWriterOptions            m_Options;
+  std::vector<unsigned char*> m_vBuffers;  // All buffers, owned.
+  std::vector<unsigned char*> m_vBlocks;   // Buffers being filled.
+  std::vector<unsigned char*> m_vSpare;    // Async mode: free buffers.
+  std::vector<PendingWrite>   m_vPending;  // Async mode: writes in flight.
+  size_t                      m_nInFlight;
+  io_uring*                   m_pRing;
+  size_t                      m_nFull;    // Full buffers at the front.
+  size_t                      m_nUsed;    // Bytes used in the current one.
+  int                         m_nFd;
+  bool                        m_bDirect;
+  bool                        m_bError;
+  uint64_t                    m_nFileOffset;
+  uint64_t                    m_nPreallocated;
+  uint64_t                    m_nUnsynced;
+  double                      m_dLastSync;
+  std::string                 m_sFilename;
+};
+
+}  // namespace hal
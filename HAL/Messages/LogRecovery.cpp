@@ -0,0 +1,103 @@
+#include <HAL/Messages/LogRecovery.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <glog/logging.h>
+
+#include <HAL/Messages/LogIndex.h>
+#include <HAL/Messages/LogManifest.h>
+
+namespace hal {
+
+namespace {
+
+bool FileSize(const std::string& sFilename, uint64_t* pSize) {
+  struct stat st;
+  if (stat(sFilename.c_str(), &st) != 0) {
+    return false;
+  }
+  *pSize = st.st_size;
+  return true;
+}
+
+/// Recover one file. `pIndex` is left holding its index.
+bool RecoverFile(const std::string& sFilename, bool bDryRun,
+                 LogIndex* pIndex, LogRecoveryResult* pResult) {
+  ++pResult->num_files;
+  if (pIndex->Load(sFilename)) {
+    return true;
+  }
+
+  uint64_t nSize, nEnd;
+  if (!FileSize(sFilename, &nSize) || !pIndex->Rebuild(sFilename, &nEnd)) {
+    LOG(ERROR) << "HAL: Failed to read log '" << sFilename << "'.";
+    return false;
+  }
+
+  ++pResult->num_recovered;
+  pResult->num_records += pIndex->Size();
+  pResult->bytes_cut += nSize - nEnd;
+  if (bDryRun) {
+    return true;
+  }
+
+  if (nEnd < nSize && truncate(sFilename.c_str(), nEnd) != 0) {
+    LOG(ERROR) << "HAL: Failed to truncate log '" << sFilename << "'.";
+    return false;
+  }
+  if (!pIndex->Append(sFilename)) {
+    LOG(ERROR) << "HAL: Failed to write the index of '" << sFilename << "'.";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool RecoverLog(const std::string& sFilename, bool bDryRun,
+                LogRecoveryResult* pResult) {
+  LogRecoveryResult result;
+  if (!pResult) {
+    pResult = &result;
+  }
+  *pResult = LogRecoveryResult();
+
+  LogIndex index;
+  LogManifest manifest;
+  if (!LogManifest::IsManifest(sFilename) || !manifest.Load(sFilename)) {
+    return RecoverFile(sFilename, bDryRun, &index, pResult);
+  }
+
+  bool ok = true;
+  bool bManifestChanged = false;
+  for (size_t ii = 0; ii < manifest.Size(); ++ii) {
+    const std::string sSegment = manifest.SegmentPath(ii);
+    if (!RecoverFile(sSegment, bDryRun, &index, pResult)) {
+      ok = false;
+      continue;
+    }
+
+    // The segment being written when the logger died has no summary.
+    hal::LogSegmentMsg* pSegment = manifest.Mutable(ii);
+    uint64_t nSize;
+    if (!pSegment->has_num_messages() && !bDryRun &&
+        FileSize(sSegment, &nSize)) {
+      if (!index.Empty()) {
+        pSegment->set_start_time(index[0].timestamp);
+        pSegment->set_end_time(index[index.Size() - 1].timestamp);
+      }
+      pSegment->set_num_messages(index.Size());
+      pSegment->set_size_bytes(nSize);
+      bManifestChanged = true;
+    }
+  }
+
+  if (bManifestChanged && !manifest.Save(sFilename)) {
+    ok = false;
+  }
+  return ok;
+}
+
+}  // namespace hal
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+namespace hal {
+
+/// What RecoverLog() did, summed over the files of a log.
+struct LogRecoveryResult {
+  LogRecoveryResult()
+      : num_files(0), num_recovered(0), num_records(0), bytes_cut(0) {}
+
+  size_t   num_files;      // Files looked at.
+  size_t   num_recovered;  // Files which were cut and given an index.
+  size_t   num_records;    // Records in the recovered files.
+  uint64_t bytes_cut;      // Truncated tails dropped.
+};
+
+/**
+ * Make a log which was cut off, e.g. when the recording machine lost
+ * power, whole again.
+ *
+ * The records of a log without an index are found in one pass over
+ * the record framing (see LogIndex::Rebuild()), which skips over the
+ * payloads rather than reading them. The file is then truncated after
+ * the last complete record and the index appended, so it can be read
+ * and seeked in as if its logger had closed it. Logs which have their
+ * index are left alone.
+ *
+ * For the manifest of a segmented log, every segment is recovered and
+ * the manifest's record of the segment that was being written is
+ * completed.
+ *
+ * With `bDryRun` nothing is written; `pResult` tells what would be.
+ * Returns false if the log can't be read or written.
+ */
+bool RecoverLog(const std::string& sFilename, bool bDryRun = false,
+                LogRecoveryResult* pResult = nullptr);
+
+}  // namespace hal
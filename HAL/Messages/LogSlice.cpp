@@ -0,0 +1,223 @@
+#include <HAL/Messages/LogSlice.h>
+
+#include <algorithm>
+#include <climits>
+#include <limits>
+#include <memory>
+
+#include <glog/logging.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+
+#include <HAL/Messages/LogBlob.h>
+#include <HAL/Messages/LogManifest.h>
+#include <HAL/Messages/LogOutputStream.h>
+#include <HAL/Messages/MappedLog.h>
+
+namespace hal {
+
+using google::protobuf::io::ArrayInputStream;
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+
+namespace {
+
+/// Length of the record starting at `nOffset` of a mapped log, size
+/// prefix included, and of its prefix. Returns false if it runs past
+/// the end of the file.
+bool RecordLength(const MappedFile& file, uint64_t nOffset, size_t* pLength,
+                  size_t* pPrefix) {
+  if (nOffset >= file.size()) {
+    return false;
+  }
+
+  const size_t nAvailable = file.size() - nOffset;
+  CodedInputStream coded_input(file.data() + nOffset,
+                               std::min<size_t>(nAvailable, 16));
+  uint32_t nSize;
+  if (!coded_input.ReadVarint32(&nSize) ||
+      nSize > nAvailable - coded_input.CurrentPosition()) {
+    return false;
+  }
+  *pPrefix = coded_input.CurrentPosition();
+  *pLength = *pPrefix + nSize;
+  return true;
+}
+
+bool LoadIndex(const std::string& sFilename, LogIndex* pIndex) {
+  if (pIndex->Load(sFilename)) {
+    return true;
+  }
+  LOG(WARNING) << "HAL: Log '" << sFilename << "' has no index, "
+               << "rebuilding it from its records.";
+  return pIndex->Rebuild(sFilename);
+}
+
+/// Length of the magic number and header at the start of a mapped log,
+/// 0 if it is not a HAL log.
+size_t HeaderLength(const MappedFile& file) {
+  ArrayInputStream header_input(file.data(),
+                                std::min<size_t>(file.size(), INT_MAX));
+  if (!ReadLogHeader(&header_input, nullptr)) {
+    return 0;
+  }
+  return header_input.ByteCount();
+}
+
+}  // namespace
+
+LogSliceOptions::LogSliceOptions()
+    : start_time(-std::numeric_limits<double>::infinity()),
+      end_time(std::numeric_limits<double>::infinity()),
+      relative_times(false) {}
+
+bool LogSliceOptions::Keeps(const LogIndexEntry& entry) const {
+  if (IsLogFooter(entry) || entry.timestamp < start_time ||
+      entry.timestamp > end_time) {
+    return false;
+  }
+  if (!types.empty() &&
+      std::find(types.begin(), types.end(), entry.type) == types.end()) {
+    return false;
+  }
+  return camera_ids.empty() || entry.type != hal::Msg::kCameraFieldNumber ||
+      std::find(camera_ids.begin(), camera_ids.end(), entry.id) !=
+      camera_ids.end();
+}
+
+bool SliceLog(const std::string& sInput, const std::string& sOutput,
+              const LogSliceOptions& options, size_t* pNumRecords) {
+  if (pNumRecords) {
+    *pNumRecords = 0;
+  }
+
+  LogManifest manifest;
+  std::vector<std::string> vFiles;
+  if (LogManifest::IsManifest(sInput) && manifest.Load(sInput)) {
+    for (size_t ii = 0; ii < manifest.Size(); ++ii) {
+      vFiles.push_back(manifest.SegmentPath(ii));
+    }
+  } else {
+    vFiles.push_back(sInput);
+  }
+  if (vFiles.empty()) {
+    LOG(ERROR) << "HAL: Manifest '" << sInput << "' lists no segments.";
+    return false;
+  }
+
+  // The slice starts with the header of the first file.
+  std::shared_ptr<const MappedFile> pFile = MappedFile::Open(vFiles[0]);
+  const size_t nHeaderLength = pFile ? HeaderLength(*pFile) : 0;
+  if (nHeaderLength == 0) {
+    LOG(ERROR) << "HAL: '" << vFiles[0] << "' is not a readable HAL log.";
+    return false;
+  }
+
+  const LogWriterOptions writer_options;
+  LogOutputStream raw_output(writer_options);
+  if (!raw_output.Open(sOutput)) {
+    LOG(ERROR) << "HAL: Failed to open '" << sOutput << "' for writing.";
+    return false;
+  }
+
+  LogIndex out_index;
+  uint64_t nOffset = nHeaderLength;
+  bool ok = true;
+  {
+    CodedOutputStream coded_output(&raw_output);
+    coded_output.WriteRaw(pFile->data(), nHeaderLength);
+
+    LogSliceOptions window = options;
+    bool bHaveStart = !options.relative_times;
+    for (size_t ii = 0; ok && ii < vFiles.size(); ++ii) {
+      if (!manifest.Empty() && bHaveStart) {
+        const hal::LogSegmentMsg& segment = manifest[ii];
+        if ((segment.has_end_time() &&
+             segment.end_time() < window.start_time) ||
+            (segment.has_start_time() &&
+             segment.start_time() > window.end_time)) {
+          continue;
+        }
+      }
+
+      LogIndex index;
+      if (ii > 0) {
+        pFile = MappedFile::Open(vFiles[ii]);
+      }
+      if (!pFile || !LoadIndex(vFiles[ii], &index)) {
+        LOG(ERROR) << "HAL: Failed to read '" << vFiles[ii] << "'.";
+        ok = false;
+        break;
+      }
+
+      if (!bHaveStart && !index.Empty()) {
+        window.start_time += index[0].timestamp;
+        window.end_time += index[0].timestamp;
+        bHaveStart = true;
+      }
+
+      // Copy runs of consecutive records to keep with one write each.
+      // The padding of records with blobs depends on where they are in
+      // the file: those are laid out again.
+      size_t jj = 0;
+      std::string meta;
+      std::vector<ImageView> blobs;
+      while (jj < index.Size()) {
+        if (!window.Keeps(index[jj])) {
+          ++jj;
+          continue;
+        }
+
+        const uint64_t nStart = index[jj].offset;
+        uint64_t nEnd = nStart;
+        size_t nLength, nPrefix;
+        bool bBlobs = false;
+        while (jj < index.Size() && index[jj].offset == nEnd &&
+               window.Keeps(index[jj])) {
+          if (!RecordLength(*pFile, nEnd, &nLength, &nPrefix)) {
+            LOG(ERROR) << "HAL: Log '" << vFiles[ii]
+                       << "' ends in a truncated record.";
+            ok = false;
+            break;
+          }
+          if (index[jj].type == hal::Msg::kCameraFieldNumber &&
+              SplitBlobRecord(pFile->data() + nEnd + nPrefix,
+                              nLength - nPrefix, &meta, &blobs)) {
+            bBlobs = true;
+            break;
+          }
+          LogIndexEntry entry = index[jj];
+          entry.offset = nOffset + (nEnd - nStart);
+          out_index.Add(entry);
+          nEnd += nLength;
+          ++jj;
+        }
+
+        coded_output.WriteRaw(pFile->data() + nStart, nEnd - nStart);
+        nOffset += nEnd - nStart;
+        if (!ok) {
+          break;
+        }
+
+        if (bBlobs) {
+          LogIndexEntry entry = index[jj];
+          entry.offset = nOffset;
+          out_index.Add(entry);
+          nOffset += WriteBlobRecord(&coded_output, nOffset,
+                                     writer_options.alignment, meta, blobs);
+          ++jj;
+        }
+      }
+    }
+
+    ok = out_index.WriteFooter(&coded_output, nOffset) && ok;
+  }
+  ok = raw_output.Close() && !raw_output.HadError() && ok;
+
+  if (pNumRecords) {
+    *pNumRecords = out_index.Size();
+  }
+  return ok;
+}
+
+}  // namespace hal
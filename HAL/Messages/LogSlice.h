@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <HAL/Messages/LogIndex.h>
+
+namespace hal {
+
+/// Records of a log to keep when slicing it, see SliceLog().
+struct LogSliceOptions {
+  LogSliceOptions();
+
+  /// Keep records stamped within [start_time, end_time] (hal::Msg
+  /// timestamps). Unbounded by default.
+  double                start_time;
+  double                end_time;
+
+  /// Times are seconds after the first record of the log rather than
+  /// timestamps.
+  bool                  relative_times;
+
+  /// Payload types (hal::Msg field numbers, e.g.
+  /// hal::Msg::kImuFieldNumber) to keep. All of them if empty.
+  std::vector<uint32_t> types;
+
+  /// Cameras to keep. Every camera if empty.
+  std::vector<int32_t>  camera_ids;
+
+  /// True if the record is kept. Times are taken as they are.
+  bool Keeps(const LogIndexEntry& entry) const;
+};
+
+/**
+ * Copy the records of a log selected by `options` into a new log.
+ *
+ * Records are found through the log's index, rebuilt from the record
+ * framing for logs without one, and copied byte for byte, runs of
+ * consecutive records at a time: payloads are neither parsed nor
+ * serialized again. Records with out of band image data only get new
+ * padding, for their blobs to stay aligned in the new log (see
+ * hal::WriteBlobRecord()). The new log gets the header of the old one
+ * and an index of its own. `sInput` may be the manifest of a segmented
+ * log; segments entirely outside the time range are not even opened
+ * then.
+ *
+ * Returns false if the log can't be read or the slice can't be
+ * written. `pNumRecords`, if given, is set to the number of records
+ * copied.
+ */
+bool SliceLog(const std::string& sInput, const std::string& sOutput,
+              const LogSliceOptions& options, size_t* pNumRecords = nullptr);
+
+}  // namespace hal
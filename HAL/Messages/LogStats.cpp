@@ -0,0 +1,223 @@
+#include <HAL/Messages/LogStats.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <sstream>
+
+#include <glog/logging.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+
+#include <HAL/Messages/LogManifest.h>
+#include <HAL/Messages/MappedLog.h>
+
+namespace hal {
+
+using google::protobuf::io::ArrayInputStream;
+using google::protobuf::io::CodedInputStream;
+
+namespace {
+
+const int    kBucketsPerOctave = 8;
+const size_t kNumBuckets = 40 * kBucketsPerOctave;  // Up to ~12 days.
+const double kSmallestGap = 1e-6;
+
+std::string ImageFormat(const hal::ImageMsg& image) {
+  std::stringstream ss;
+  ss << image.width() << "x" << image.height() << " "
+     << hal::Format_Name(image.format()) << " "
+     << hal::Type_Name(image.type());
+  if (image.codec() != hal::PB_CODEC_NONE) {
+    ss << " " << hal::ImageCodec_Name(image.codec());
+  }
+  return ss.str();
+}
+
+}  // namespace
+
+GapHistogram::GapHistogram()
+    : m_vBuckets(kNumBuckets, 0), m_nCount(0), m_dMin(0), m_dMax(0) {}
+
+size_t GapHistogram::Bucket(double dGap) {
+  if (!(dGap >= kSmallestGap)) {
+    return 0;
+  }
+  const double dBucket =
+      1 + std::floor(std::log2(dGap / kSmallestGap) * kBucketsPerOctave);
+  return std::min<size_t>(static_cast<size_t>(dBucket), kNumBuckets - 1);
+}
+
+double GapHistogram::BucketCenter(size_t nBucket) {
+  if (nBucket == 0) {
+    return 0;
+  }
+  return kSmallestGap * std::exp2((nBucket - 0.5) / kBucketsPerOctave);
+}
+
+void GapHistogram::Add(double dGap) {
+  ++m_vBuckets[Bucket(dGap)];
+  m_dMin = m_nCount == 0 ? dGap : std::min(m_dMin, dGap);
+  m_dMax = m_nCount == 0 ? dGap : std::max(m_dMax, dGap);
+  ++m_nCount;
+}
+
+double GapHistogram::Quantile(double dFraction) const {
+  if (m_nCount == 0) {
+    return 0;
+  }
+  const uint64_t nRank = std::min<uint64_t>(
+      m_nCount - 1, static_cast<uint64_t>(dFraction * m_nCount));
+  uint64_t nSeen = 0;
+  for (size_t ii = 0; ii < kNumBuckets; ++ii) {
+    nSeen += m_vBuckets[ii];
+    if (nSeen > nRank) {
+      return std::min(std::max(BucketCenter(ii), m_dMin), m_dMax);
+    }
+  }
+  return m_dMax;
+}
+
+uint64_t GapHistogram::CountBetween(double dLow, double dHigh) const {
+  uint64_t nCount = 0;
+  for (size_t ii = 0; ii < kNumBuckets; ++ii) {
+    const double dCenter = BucketCenter(ii);
+    if (dCenter >= dLow && dCenter < dHigh) {
+      nCount += m_vBuckets[ii];
+    }
+  }
+  return nCount;
+}
+
+LogStreamStats::LogStreamStats()
+    : num_messages(0), num_bytes(0), first_time(0), last_time(0),
+      max_gap(0), max_gap_time(0), num_backwards(0) {}
+
+double LogStreamStats::Rate() const {
+  const double dDuration = last_time - first_time;
+  return num_messages > 1 && dDuration > 0 ?
+      (num_messages - 1) / dDuration : 0;
+}
+
+LogStats::LogStats()
+    : m_nFiles(0), m_nBytes(0), m_nIndexed(0), m_nTruncated(0) {}
+
+std::string LogStats::StreamName(const StreamId& stream) {
+  const google::protobuf::FieldDescriptor* pField =
+      hal::Msg::descriptor()->FindFieldByNumber(stream.first);
+  std::stringstream ss;
+  if (pField) {
+    ss << pField->name();
+  } else {
+    ss << "type " << stream.first;
+  }
+  if (stream.second >= 0) {
+    ss << "[" << stream.second << "]";
+  }
+  return ss.str();
+}
+
+void LogStats::Add(const LogIndexEntry& entry, size_t nRecordSize,
+                   const hal::CameraMsg* pCamera) {
+  LogStreamStats& stats = m_mStreams[StreamId(entry.type, entry.id)];
+  if (stats.num_messages == 0) {
+    stats.first_time = entry.timestamp;
+  } else {
+    const double dGap = entry.timestamp - stats.last_time;
+    if (dGap < 0) {
+      ++stats.num_backwards;
+    }
+    if (dGap > stats.max_gap) {
+      stats.max_gap = dGap;
+      stats.max_gap_time = entry.timestamp;
+    }
+    stats.gaps.Add(dGap);
+  }
+  stats.last_time = entry.timestamp;
+  ++stats.num_messages;
+  stats.num_bytes += nRecordSize;
+
+  if (pCamera) {
+    for (const hal::ImageMsg& image : pCamera->image()) {
+      ++stats.image_formats[ImageFormat(image)];
+    }
+  }
+}
+
+bool LogStats::Scan(const std::string& sFilename) {
+  LogManifest manifest;
+  if (!LogManifest::IsManifest(sFilename) || !manifest.Load(sFilename)) {
+    return _ScanFile(sFilename);
+  }
+
+  bool ok = true;
+  for (size_t ii = 0; ii < manifest.Size(); ++ii) {
+    ok = _ScanFile(manifest.SegmentPath(ii)) && ok;
+  }
+  return ok;
+}
+
+bool LogStats::_ScanFile(const std::string& sFilename) {
+  std::shared_ptr<const MappedFile> pFile = MappedFile::Open(sFilename);
+  if (!pFile) {
+    LOG(ERROR) << "HAL: File '" << sFilename << "' could not be opened.";
+    return false;
+  }
+
+  ArrayInputStream header_input(pFile->data(),
+                                std::min<size_t>(pFile->size(), INT_MAX));
+  if (!ReadLogHeader(&header_input, nullptr)) {
+    LOG(ERROR) << "HAL: '" << sFilename << "' is not a HAL log.";
+    return false;
+  }
+
+  ++m_nFiles;
+  m_nBytes += pFile->size();
+
+  hal::Msg msg;
+  std::vector<ImageView> vViews;
+  size_t nPos = header_input.ByteCount();
+  while (nPos < pFile->size()) {
+    const size_t nAvailable = pFile->size() - nPos;
+    CodedInputStream size_input(pFile->data() + nPos,
+                                std::min<size_t>(nAvailable, 16));
+    uint32_t nSize;
+    if (!size_input.ReadVarint32(&nSize) ||
+        nSize > nAvailable - size_input.CurrentPosition()) {
+      ++m_nTruncated;
+      break;
+    }
+    if (nSize == 0 && IsZeroFilledTail(pFile->data() + nPos, nAvailable)) {
+      ++m_nTruncated;
+      break;
+    }
+
+    const unsigned char* pRecord =
+        pFile->data() + nPos + size_input.CurrentPosition();
+    const size_t nRecordSize = size_input.CurrentPosition() + nSize;
+    nPos += nRecordSize;
+
+    CodedInputStream record_input(pRecord, nSize);
+    LogIndexEntry entry;
+    if (!ReadLogRecordInfo(&record_input, nSize, &entry)) {
+      ++m_nTruncated;
+      break;
+    }
+    if (IsLogFooter(entry)) {
+      ++m_nIndexed;
+      break;
+    }
+
+    const hal::CameraMsg* pCamera = nullptr;
+    if (entry.type == hal::Msg::kCameraFieldNumber &&
+        ParseMsgWithoutImageData(pRecord, nSize, &msg, &vViews)) {
+      pCamera = &msg.camera();
+    }
+    Add(entry, nRecordSize, pCamera);
+  }
+  return true;
+}
+
+}  // namespace hal
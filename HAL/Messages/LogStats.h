@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <HAL/Messages.pb.h>
+#include <HAL/Messages/LogIndex.h>
+
+namespace hal {
+
+/**
+ * Histogram of the time between consecutive messages of a stream.
+ *
+ * Buckets are spaced logarithmically, eight per doubling (about 9 %
+ * wide) from a microsecond up, so quantiles and the spread around the
+ * nominal period come out of one pass in constant memory.
+ */
+class GapHistogram {
+ public:
+  GapHistogram();
+
+  void Add(double dGap);
+
+  uint64_t Count() const { return m_nCount; }
+
+  /// Gap which the given fraction of gaps do not exceed, to the
+  /// resolution of the buckets but within the shortest and longest
+  /// gap. 0 if there are no gaps.
+  double Quantile(double dFraction) const;
+
+  /// Number of gaps in [dLow, dHigh), to the resolution of the buckets.
+  uint64_t CountBetween(double dLow, double dHigh) const;
+
+ private:
+  static size_t Bucket(double dGap);
+  static double BucketCenter(size_t nBucket);
+
+  std::vector<uint64_t> m_vBuckets;
+  uint64_t              m_nCount;
+  double                m_dMin;
+  double                m_dMax;
+};
+
+/** Statistics of one stream of a log, see LogStats. */
+struct LogStreamStats {
+  LogStreamStats();
+
+  /// Messages per second between the first and last message.
+  double Rate() const;
+
+  uint64_t                        num_messages;
+  uint64_t                        num_bytes;      // Records, framing included.
+  double                          first_time;     // hal::Msg timestamps.
+  double                          last_time;
+  double                          max_gap;
+  double                          max_gap_time;   // Where the gap ends.
+  uint64_t                        num_backwards;  // Timestamps going back.
+  GapHistogram                    gaps;
+  std::map<std::string, uint64_t> image_formats;  // By description.
+};
+
+/**
+ * Per stream statistics of a log, gathered in a single pass over its
+ * record framing.
+ *
+ * Only the timestamp, payload type and id of most records are decoded
+ * (see ReadLogRecordInfo()). Camera records are parsed without their
+ * pixel data, for the size and format of their images.
+ */
+class LogStats {
+ public:
+  /** Payload type (hal::Msg field number) and id of a stream. */
+  typedef std::pair<uint32_t, int32_t> StreamId;
+
+  LogStats();
+
+  /// Scan a log, or every segment of a manifest, adding to the
+  /// statistics. Returns false if it can't be read.
+  bool Scan(const std::string& sFilename);
+
+  /// Account for one record.
+  void Add(const LogIndexEntry& entry, size_t nRecordSize,
+           const hal::CameraMsg* pCamera);
+
+  const std::map<StreamId, LogStreamStats>& streams() const {
+    return m_mStreams;
+  }
+
+  /// Name of a stream, e.g. "camera[1]" or "imu".
+  static std::string StreamName(const StreamId& stream);
+
+  uint64_t num_files() const { return m_nFiles; }
+  uint64_t num_bytes() const { return m_nBytes; }
+  uint64_t num_indexed() const { return m_nIndexed; }      // Files.
+  uint64_t num_truncated() const { return m_nTruncated; }  // Files.
+
+ private:
+  bool _ScanFile(const std::string& sFilename);
+
+  std::map<StreamId, LogStreamStats> m_mStreams;
+  uint64_t                           m_nFiles;
+  uint64_t                           m_nBytes;
+  uint64_t                           m_nIndexed;
+  uint64_t                           m_nTruncated;
+};
+
+}  // namespace hal
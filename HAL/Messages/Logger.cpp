@@ -1,5 +1,10 @@
 #include <HAL/config.h>
 #include <HAL/Messages/Logger.h>
+#include <HAL/Messages/ImageCodec.h>
+#include <HAL/Messages/ImageLayout.h>
+#include <HAL/Messages/LogIndex.h>
+#include <HAL/Messages/LogManifest.h>
+#include <HAL/Messages/LogOutputStream.h>
 
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -8,11 +13,12 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <chrono>
 #include <functional>
 #include <iostream>
 
 #include <glog/logging.h>
-#include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/io/coded_stream.h>
 
 namespace hal {
@@ -30,110 +36,547 @@ inline double RealTime() {
 #endif
 }
 
+namespace {
+
+/// Queued messages a producer evicts at most to make room for its own,
+/// under Backpressure_DropOldest and Backpressure_DropLowPriority.
+const int kMaxEvictions = 4;
+
+}  // namespace
+
 Logger& Logger::GetInstance() {
   static Logger s_instance;
   return s_instance;
 }
 
-Logger::Logger() : m_sFilename("proto.log"),
+Logger::Logger() : m_nConsumersWaiting(0),
+                   m_sFilename("proto.log"),
                    m_bShouldRun(false),
                    m_nMaxBufferSize(5000),
-                   m_nMessagesWritten(0) {
+                   m_nMessagesWritten(0),
+                   m_nNextSequence(0),
+                   m_nNextToWrite(0),
+                   m_nActiveWorkers(0),
+                   m_ePolicy(Backpressure_DropNewest),
+                   m_dBlockTimeout(0.1),
+                   m_dPriorityReserve(0.25),
+                   m_nLowPriorityTypes((1u << hal::Msg::kCameraFieldNumber) |
+                                       (1u << hal::Msg::kLidarFieldNumber)),
+                   m_nProducersWaiting(0),
+                   m_nHighWaterMark(0),
+                   m_nMessagesDropped(0) {
 }
 
 Logger::~Logger() {
   StopLogging();
 }
 
-void Logger::ThreadFunc() {
-  mode_t OpenMode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
-  int fd = open(m_sFilename.c_str(), O_RDWR | O_CREAT | O_TRUNC, OpenMode);
+void Logger::ThreadFunc(LogSettings settings) {
+  const uint64_t nSegmentMaxBytes = settings.segment_max_bytes;
+  const double dSegmentMaxSeconds = settings.segment_max_seconds;
+  const unsigned int nWorkers = settings.num_workers;
+  const bool bSegmented = nSegmentMaxBytes > 0 || dSegmentMaxSeconds > 0;
+  hal::LogOutputStream raw_output(settings.writer_options);
+  hal::LogManifest manifest;
+  std::string sSegment = m_sFilename;
+
+  // The coded stream holds on to part of the current write buffer: it is
+  // dropped whenever the queue runs dry, so the buffered data can be
+  // flushed and synced on time.
+  std::unique_ptr<google::protobuf::io::CodedOutputStream> pCoded;
+  auto coded = [&]() {
+    if (!pCoded) {
+      pCoded.reset(new google::protobuf::io::CodedOutputStream(&raw_output));
+    }
+    return pCoded.get();
+  };
+
+  // Track record offsets ourselves: ByteCount() is only 32 bits wide in
+  // older protobuf releases.
+  hal::LogIndex index;
+  uint64_t offset = 0;
+  double dSegmentStart = 0;
+
+  auto open_segment = [&]() {
+    if (bSegmented) {
+      sSegment = LogManifest::SegmentFilename(m_sFilename, manifest.Size());
+      manifest.Add(sSegment);
+      manifest.Save(m_sFilename);
+    }
+    if (!raw_output.Open(sSegment)) {
+      return false;
+    }
+    index.Clear();
+    dSegmentStart = RealTime();
 
-  if(fd == 0) {
-    LOG(ERROR) << "Error opening file " << m_sFilename << std::endl;
-    return;
-  }
+    ///-------------------- Write Magic Number %HAL
+    const char magic_number[] = { '%', 'H', 'A', 'L' };
+    coded()->WriteRaw(magic_number,4);
 
-  google::protobuf::io::FileOutputStream raw_output(fd);
-  raw_output.SetCloseOnDelete(true);
-  google::protobuf::io::CodedOutputStream coded_output(&raw_output);
+    ///-------------------- Write Header Msg
+    hal::Header hdr;
+    hdr.set_version(Messages_VERSION);
+    hdr.set_date(RealTime());
+    hdr.set_description("HAL Log File.");
 
-  ///-------------------- Write Magic Number %HAL
-  const char magic_number[] = { '%', 'H', 'A', 'L' };
-  coded_output.WriteRaw(magic_number,4);
+    const int hdr_size_bytes = hdr.ByteSize();
+    coded()->WriteVarint32(hdr_size_bytes);
 
-  ///-------------------- Write Header Msg
-  hal::Header hdr;
-  hdr.set_version(Messages_VERSION);
-  hdr.set_date(RealTime());
-  hdr.set_description("HAL Log File.");
+    if(!hdr.SerializeToCodedStream(coded())) {
+      LOG(FATAL) << "HAL: Failed to serialize HEADER to coded stream.";
+    }
 
-  coded_output.WriteVarint32(hdr.ByteSize());
+    offset = sizeof(magic_number) +
+        google::protobuf::io::CodedOutputStream::VarintSize32(hdr_size_bytes) +
+        hdr_size_bytes;
+    return true;
+  };
 
-  if(!hdr.SerializeToCodedStream(&coded_output)) {
-    LOG(FATAL) << "HAL: Failed to serialize HEADER to coded stream.";
-  }
+  auto close_segment = [&]() {
+    ///-------------------- Write Index Footer
+    if (!index.WriteFooter(coded(), offset)) {
+      LOG(WARNING) << "HAL: Failed to write index to " << sSegment << ".";
+    }
+    pCoded.reset();
+    if (!raw_output.Close()) {
+      LOG(ERROR) << "HAL: Failed to write " << sSegment << ".";
+    }
 
-  while (m_bShouldRun || !m_qMessages.empty()) {
-    {
-      std::unique_lock<std::mutex> lock(m_QueueMutex);
-      if (m_qMessages.empty()) {
-        m_QueueCondition.wait(lock, [this]() {
-            return !m_bShouldRun || !m_qMessages.empty();
-          });
+    if (bSegmented) {
+      hal::LogSegmentMsg* pSegment = manifest.Mutable(manifest.Size() - 1);
+      for (size_t ii = 0; ii < index.Size(); ++ii) {
+        const double dTime = index[ii].timestamp;
+        if (ii == 0 || dTime < pSegment->start_time()) {
+          pSegment->set_start_time(dTime);
+        }
+        if (ii == 0 || dTime > pSegment->end_time()) {
+          pSegment->set_end_time(dTime);
+        }
       }
+      pSegment->set_num_messages(index.Size());
+      pSegment->set_size_bytes(raw_output.bytes_written());
+      manifest.Save(m_sFilename);
     }
+  };
+
+  // Called after every record. Should the next segment fail to open,
+  // the rest of the log is discarded.
+  auto roll = [&]() {
+    if (!raw_output.IsOpen() ||
+        !((nSegmentMaxBytes > 0 && offset >= nSegmentMaxBytes) ||
+          (dSegmentMaxSeconds > 0 &&
+           RealTime() - dSegmentStart >= dSegmentMaxSeconds))) {
+      return;
+    }
+    close_segment();
+    if (!open_segment()) {
+      LOG(ERROR) << "HAL: Could not start segment " << sSegment
+                 << ", dropping the rest of the log.";
+    }
+  };
 
-    if (m_qMessages.empty()) continue;
+  if (!open_segment()) {
+    return;
+  }
 
-    hal::Msg& msg = m_qMessages.front();
-    if (msg.IsInitialized()) {
-      coded_output.WriteVarint32(msg.ByteSize());
-      if(!msg.SerializeToCodedStream(&coded_output)) {
+  std::string meta;
+  google::protobuf::RepeatedPtrField<std::string> blobs;
+  auto write = [&](hal::Msg& msg) {
+    if (msg.has_camera() && raw_output.IsOpen()) {
+      EncodeImages(settings, msg.mutable_camera());
+    }
+    if (!raw_output.IsOpen()) {
+      // The next segment could not be opened, see roll.
+    } else if (msg.IsInitialized() && settings.blob_min_bytes > 0 &&
+               msg.has_camera() &&
+               DetachImageBlobs(msg.mutable_camera(), settings.blob_min_bytes,
+                                &blobs) > 0) {
+      msg.SerializeToString(&meta);
+      index.Add(offset, msg);
+      offset += WriteBlobRecord(coded(), offset, raw_output.alignment(),
+                                meta, blobs);
+    } else if (msg.IsInitialized()) {
+      const int msg_size_bytes = msg.ByteSize();
+      coded()->WriteVarint32(msg_size_bytes);
+      if(!msg.SerializeToCodedStream(coded())) {
         LOG(WARNING) << "Failed to serialize to coded stream.";
       }
+      index.Add(offset, msg);
+      offset += google::protobuf::io::CodedOutputStream::VarintSize32(
+          msg_size_bytes) + msg_size_bytes;
     } else {
       LOG(WARNING) << "Message is not initialized missing fields ("
                    << msg.InitializationErrorString() << "). Cannot serialize.";
     }
 
-    std::lock_guard<std::mutex> lock(m_QueueMutex);
-    m_qMessages.pop_front();
+    // Clearing keeps the buffers around: they go back to a slot with
+    // the next message.
+    msg.Clear();
+  };
+
+  // Called whenever the writer runs out of data.
+  auto idle = [&]() {
+    pCoded.reset();
+    if (!raw_output.Poll()) {
+      LOG(ERROR) << "HAL: Failed to write to " << sSegment << ".";
+    }
+  };
+
+  // Messages are moved out of their slot before they are written, so a
+  // stalled write holds up no slot: the producers keep the whole queue.
+  hal::Msg msg;
+  while (nWorkers == 0) {
+    if (!m_pQueue->TryPop([&msg](hal::Msg& slot) { msg.Swap(&slot); })) {
+      if (!m_bShouldRun) {
+        break;
+      }
+
+      idle();
+      WaitForMessages();
+      continue;
+    }
+
+    WakeProducers();
+    write(msg);
     ++m_nMessagesWritten;
+    roll();
+  }
+
+  ///-------------------- Write records serialized by the workers
+  if (nWorkers > 0) {
+    m_nNextSequence = 0;
+    m_nNextToWrite = 0;
+    m_nActiveWorkers = nWorkers;
+    m_vReorder.assign(4 * nWorkers, SerializedMsg());
+
+    std::vector<std::thread> workers;
+    for (unsigned int ii = 0; ii < nWorkers; ++ii) {
+      workers.emplace_back(&Logger::WorkerFunc, this, std::cref(settings));
+    }
+
+    std::string data;
+    hal::LogIndexEntry entry;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(m_ReorderMutex);
+        SerializedMsg& slot = m_vReorder[m_nNextToWrite % m_vReorder.size()];
+        if (!slot.ready) {
+          if (m_nActiveWorkers == 0) {
+            break;
+          }
+          lock.unlock();
+          idle();
+          lock.lock();
+          m_ReorderReady.wait_for(lock, std::chrono::milliseconds(10), [&]() {
+              return slot.ready || m_nActiveWorkers == 0;
+            });
+          continue;
+        }
+
+        data.swap(slot.data);
+        blobs.Swap(&slot.blobs);
+        entry = slot.entry;
+        slot.ready = false;
+        ++m_nNextToWrite;
+      }
+      m_ReorderFree.notify_all();
+
+      if (!data.empty() && raw_output.IsOpen()) {
+        entry.offset = offset;
+        index.Add(entry);
+        if (blobs.size() > 0) {
+          offset += WriteBlobRecord(coded(), offset,
+                                    raw_output.alignment(), data, blobs);
+        } else {
+          coded()->WriteRaw(data.data(), data.size());
+          offset += data.size();
+        }
+      }
+      ++m_nMessagesWritten;
+      roll();
+    }
+
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+  }
+
+  if (raw_output.IsOpen()) {
+    close_segment();
   }
 
   LOG(INFO) << "Logger thread stopped. Wrote " << m_nMessagesWritten
             << " frames to " << m_sFilename << ".";
+
+  if (m_nMessagesDropped > 0) {
+    std::lock_guard<std::mutex> lock(m_DropMutex);
+    std::stringstream ss;
+    for (const auto& dropped : m_mDropped) {
+      ss << " [type " << dropped.first.first << ", id "
+         << dropped.first.second << "]: " << dropped.second;
+    }
+    LOG(WARNING) << "Logger dropped " << m_nMessagesDropped
+                 << " messages, buffer high water mark " << m_nHighWaterMark
+                 << " of " << m_pQueue->Capacity() << "." << ss.str();
+  }
 }
 
-bool Logger::LogMessage(const hal::Msg &message) {
+void Logger::WorkerFunc(const LogSettings& settings) {
+  hal::Msg msg;
+  std::string data;
+  google::protobuf::RepeatedPtrField<std::string> blobs;
+  hal::LogIndexEntry entry;
+  while (true) {
+    // Sequence numbers follow the queue order, which is the call order.
+    uint64_t seq = 0;
+    bool popped;
+    {
+      std::lock_guard<std::mutex> lock(m_PopMutex);
+      popped = m_pQueue->TryPop([&msg](hal::Msg& slot) { msg.Swap(&slot); });
+      if (popped) {
+        seq = m_nNextSequence++;
+      }
+    }
+
+    if (!popped) {
+      if (!m_bShouldRun) {
+        break;
+      }
+      WaitForMessages();
+      continue;
+    }
+    WakeProducers();
+
+    SerializeMessage(settings, &msg, &data, &blobs, &entry);
+    msg.Clear();
+
+    // Stay within the reorder window of the writer.
+    std::unique_lock<std::mutex> lock(m_ReorderMutex);
+    m_ReorderFree.wait(lock, [&]() {
+        return seq < m_nNextToWrite + m_vReorder.size();
+      });
+    SerializedMsg& slot = m_vReorder[seq % m_vReorder.size()];
+    slot.data.swap(data);
+    slot.blobs.Swap(&blobs);
+    slot.entry = entry;
+    slot.ready = true;
+    lock.unlock();
+    m_ReorderReady.notify_one();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_ReorderMutex);
+    --m_nActiveWorkers;
+  }
+  m_ReorderReady.notify_one();
+}
+
+void Logger::SerializeMessage(
+    const LogSettings& settings, hal::Msg* pMsg, std::string* pData,
+    google::protobuf::RepeatedPtrField<std::string>* pBlobs,
+    hal::LogIndexEntry* pEntry) {
+  pData->clear();
+  pBlobs->Clear();
+  if (pMsg->has_camera()) {
+    EncodeImages(settings, pMsg->mutable_camera());
+  }
+  if (!pMsg->IsInitialized()) {
+    LOG(WARNING) << "Message is not initialized missing fields ("
+                 << pMsg->InitializationErrorString()
+                 << "). Cannot serialize.";
+    return;
+  }
+
+  pEntry->timestamp = pMsg->timestamp();
+  GetLogPayload(*pMsg, &pEntry->type, &pEntry->id);
+
+  // The writer lays out records with blobs: only it knows their offset.
+  if (settings.blob_min_bytes > 0 && pMsg->has_camera() &&
+      DetachImageBlobs(pMsg->mutable_camera(), settings.blob_min_bytes,
+                       pBlobs) > 0) {
+    pMsg->SerializeToString(pData);
+    return;
+  }
+
+  const int msg_size_bytes = pMsg->ByteSize();
+  pData->resize(google::protobuf::io::CodedOutputStream::VarintSize32(
+      msg_size_bytes) + msg_size_bytes);
+  uint8_t* pTarget = reinterpret_cast<uint8_t*>(&(*pData)[0]);
+  pTarget = google::protobuf::io::CodedOutputStream::WriteVarint32ToArray(
+      msg_size_bytes, pTarget);
+  pMsg->SerializeWithCachedSizesToArray(pTarget);
+}
+
+void Logger::WaitForMessages() {
+  // Producers only take the lock to notify us while we wait. The
+  // timeout covers a wake up racing with the check below.
+  std::unique_lock<std::mutex> lock(m_QueueMutex);
+  ++m_nConsumersWaiting;
+  m_QueueCondition.wait_for(lock, std::chrono::milliseconds(10), [this]() {
+      return !m_bShouldRun || !m_pQueue->Empty();
+    });
+  --m_nConsumersWaiting;
+}
+
+template <typename Fill>
+bool Logger::QueueMessage(const hal::Msg& message, Fill&& fill) {
   if(!message.has_timestamp()){
     LOG(WARNING) << "Logging a message without a timestamp.";
   }
 
-  if(!m_WriteThread.joinable()) {
-    LogToFile(m_sFilename);
+  // Several threads may log the first messages at once: one of them
+  // starts the log, the others wait for it.
+  if (!m_bShouldRun) {
+    std::lock_guard<std::mutex> lock(m_StartMutex);
+    if (!m_bShouldRun) {
+      StartWriter(m_sFilename);
+    }
+  }
+
+  const size_t capacity = m_pQueue->Capacity();
+  if (m_ePolicy == Backpressure_DropLowPriority && IsLowPriority(message)) {
+    const size_t limit = capacity - std::min(
+        capacity, static_cast<size_t>(capacity * m_dPriorityReserve));
+    if (m_pQueue->Size() >= limit) {
+      CountDrop(message);
+      return false;
+    }
+  }
+
+  bool queued = m_pQueue->TryPush(fill);
+  if (!queued && m_ePolicy == Backpressure_Block) {
+    const auto deadline = std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(m_dBlockTimeout));
+    std::unique_lock<std::mutex> lock(m_SpaceMutex);
+    ++m_nProducersWaiting;
+    while (!(queued = m_pQueue->TryPush(fill)) &&
+           std::chrono::steady_clock::now() < deadline) {
+      // Short waits, as for the writer, cover a racing wake up.
+      m_SpaceCondition.wait_for(lock, std::chrono::milliseconds(1));
+    }
+    --m_nProducersWaiting;
+  } else if (!queued && (m_ePolicy == Backpressure_DropOldest ||
+                         m_ePolicy == Backpressure_DropLowPriority)) {
+    // Low priority messages stay clear of the reserve, so under
+    // Backpressure_DropLowPriority the oldest message is most likely one
+    // of theirs. Other producers may take the freed slot first, hence
+    // the retries, a few only: beyond that the queue is contended
+    // enough that dropping this message is as good as an older one.
+    for (int tries = 0; !queued && tries < kMaxEvictions; ++tries) {
+      m_pQueue->TryPop([this](hal::Msg& oldest) {
+          CountDrop(oldest);
+          oldest.Clear();
+        });
+      queued = m_pQueue->TryPush(fill);
+    }
   }
 
-  std::lock_guard<std::mutex> lock(m_QueueMutex);
-  if(m_qMessages.size() >= m_nMaxBufferSize) {
-    LOG(ERROR) << "Could not log message. Buffer is already at maximum size!";
+  if (!queued) {
+    CountDrop(message);
     return false;
   }
 
-  m_qMessages.push_back(message);
-  m_QueueCondition.notify_one();
+  const size_t size = m_pQueue->Size();
+  size_t high = m_nHighWaterMark.load(std::memory_order_relaxed);
+  while (size > high &&
+         !m_nHighWaterMark.compare_exchange_weak(high, size,
+                                                 std::memory_order_relaxed)) {
+  }
+
+  WakeWriter();
   return true;
 }
 
+bool Logger::LogMessage(const hal::Msg &message) {
+  return QueueMessage(message, [&message](hal::Msg& slot) {
+      slot.CopyFrom(message);
+    });
+}
+
+bool Logger::LogMessage(hal::Msg&& message) {
+  // The drop accounting reads the message before it is swapped away.
+  return QueueMessage(message, [&message](hal::Msg& slot) {
+      hal::MoveMsg(&message, &slot);
+    });
+}
+
+void Logger::EncodeImages(const LogSettings& settings,
+                          hal::CameraMsg* pCameraMsg) {
+  for (int ii = 0; ii < pCameraMsg->image_size(); ++ii) {
+    hal::ImageMsg* pImage = pCameraMsg->mutable_image(ii);
+    // Views would log the whole buffer they are part of.
+    PackImage(pImage);
+    if (IsDepthImage(*pImage) &&
+        settings.depth_codec != hal::PB_CODEC_NONE) {
+      EncodeImage(settings.depth_codec, settings.depth_codec_level, pImage);
+    } else {
+      EncodeImage(settings.image_codec, settings.image_codec_level, pImage);
+    }
+  }
+}
+
+bool Logger::IsLowPriority(const hal::Msg& message) const {
+  uint32_t type;
+  int32_t id;
+  GetLogPayload(message, &type, &id);
+  return type < 32 && (m_nLowPriorityTypes & (1u << type)) != 0;
+}
+
+void Logger::CountDrop(const hal::Msg& message) {
+  StreamId stream;
+  GetLogPayload(message, &stream.first, &stream.second);
+
+  ++m_nMessagesDropped;
+  std::lock_guard<std::mutex> lock(m_DropMutex);
+  if (m_mDropped[stream]++ == 0) {
+    LOG(WARNING) << "Logger buffer full: dropping messages of type "
+                 << stream.first << ", id " << stream.second << ".";
+  }
+}
+
+void Logger::WakeWriter() {
+  // Pairs with the consumers announcing themselves in
+  // m_nConsumersWaiting before they check the queue one last time.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (m_nConsumersWaiting > 0) {
+    std::lock_guard<std::mutex> lock(m_QueueMutex);
+    m_QueueCondition.notify_one();
+  }
+}
+
+void Logger::WakeProducers() {
+  if (m_nProducersWaiting > 0) {
+    std::lock_guard<std::mutex> lock(m_SpaceMutex);
+    m_SpaceCondition.notify_all();
+  }
+}
+
 void Logger::LogToFile(const std::string& filename) {
+  std::lock_guard<std::mutex> lock(m_StartMutex);
+  StartWriter(filename);
+}
+
+void Logger::StartWriter(const std::string& filename) {
   LOG(INFO) << "Logger thread started...";
-  StopLogging();
+  StopWriter();
+
+  if (!m_pQueue || m_pQueue->Capacity() != m_nMaxBufferSize) {
+    m_pQueue.reset(new MessageQueue(m_nMaxBufferSize));
+  }
 
   m_nMessagesWritten = 0;
+  m_nHighWaterMark = 0;
+  m_nMessagesDropped = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_DropMutex);
+    m_mDropped.clear();
+  }
   m_sFilename = filename;
   m_bShouldRun = true;
-  m_WriteThread = std::thread(&Logger::ThreadFunc, this);
+  // The writer gets its own copy of the settings: they may change for
+  // the next log while it runs.
+  m_WriteThread = std::thread(&Logger::ThreadFunc, this, m_Settings);
 }
 
 std::string Logger::LogToFile(const std::string& sLogDir,
@@ -158,15 +601,23 @@ std::string Logger::LogToFile(const std::string& sLogDir,
 }
 
 void Logger::StopLogging() {
+  std::lock_guard<std::mutex> lock(m_StartMutex);
+  StopWriter();
+}
+
+void Logger::StopWriter() {
   if(m_WriteThread.joinable()) {
     m_bShouldRun = false;
-    m_QueueCondition.notify_all();
+    {
+      std::lock_guard<std::mutex> lock(m_QueueMutex);
+      m_QueueCondition.notify_all();
+    }
     m_WriteThread.join();
   }
 }
 
 bool Logger::IsLogging() {
-  return m_WriteThread.joinable();
+  return m_bShouldRun;
 }
 
 void Logger::SetMaxBufferSize(unsigned int nBufferSize) {
@@ -174,10 +625,81 @@ void Logger::SetMaxBufferSize(unsigned int nBufferSize) {
 }
 
 size_t Logger::buffer_size() const {
-  return m_qMessages.size();
+  return m_pQueue ? m_pQueue->Size() : 0;
 }
 
 size_t Logger::messages_written() const {
   return m_nMessagesWritten;
 }
+
+void Logger::SetWriterOptions(const LogWriterOptions& options) {
+  m_Settings.writer_options = options;
+}
+
+void Logger::SetNumWorkers(unsigned int nWorkers) {
+  m_Settings.num_workers = nWorkers;
+}
+
+void Logger::SetSegmentLimits(uint64_t nMaxBytes, double dMaxSeconds) {
+  m_Settings.segment_max_bytes = nMaxBytes;
+  m_Settings.segment_max_seconds = std::max(0.0, dMaxSeconds);
+}
+
+void Logger::SetImageCodec(hal::ImageCodec codec, int nLevel) {
+  LOG_IF(WARNING, !IsImageCodecAvailable(codec))
+      << "Image codec " << hal::ImageCodec_Name(codec)
+      << " is not available, images will be logged raw.";
+  m_Settings.image_codec = codec;
+  m_Settings.image_codec_level = nLevel;
+}
+
+void Logger::SetDepthImageCodec(hal::ImageCodec codec, int nLevel) {
+  LOG_IF(WARNING, !IsImageCodecAvailable(codec))
+      << "Image codec " << hal::ImageCodec_Name(codec)
+      << " is not available, depth images will be logged raw.";
+  m_Settings.depth_codec = codec;
+  m_Settings.depth_codec_level = nLevel;
+}
+
+void Logger::SetOutOfBandImages(size_t nMinBytes) {
+  m_Settings.blob_min_bytes = nMinBytes;
+}
+
+void Logger::SetBackpressurePolicy(BackpressurePolicy ePolicy) {
+  m_ePolicy = ePolicy;
+}
+
+Logger::BackpressurePolicy Logger::backpressure_policy() const {
+  return m_ePolicy;
+}
+
+void Logger::SetBlockTimeout(double dSeconds) {
+  m_dBlockTimeout = std::max(0.0, dSeconds);
+}
+
+void Logger::SetPriorityReserve(double dFraction) {
+  m_dPriorityReserve = std::min(std::max(dFraction, 0.0), 1.0);
+}
+
+void Logger::SetLowPriority(uint32_t nPayloadType, bool bLow) {
+  CHECK_LT(nPayloadType, 32u);
+  if (bLow) {
+    m_nLowPriorityTypes |= 1u << nPayloadType;
+  } else {
+    m_nLowPriorityTypes &= ~(1u << nPayloadType);
+  }
+}
+
+std::map<Logger::StreamId, size_t> Logger::dropped_messages() const {
+  std::lock_guard<std::mutex> lock(m_DropMutex);
+  return m_mDropped;
+}
+
+size_t Logger::messages_dropped() const {
+  return m_nMessagesDropped;
+}
+
+size_t Logger::buffer_high_water_mark() const {
+  return m_nHighWaterMark;
+}
 }  // namespace hal
@@ -2,18 +2,43 @@
 
 #include <atomic>
 #include <fstream>
-#include <list>
 #include <mutex>
 #include <sstream>
 #include <thread>
 #include <condition_variable>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
 #include <HAL/Header.pb.h>
 #include <HAL/Messages.pb.h>
+#include <HAL/Messages/LogBlob.h>
+#include <HAL/Messages/LogIndex.h>
+#include <HAL/Messages/LogOutputStream.h>
+#include <HAL/Messages/MsgArena.h>
+#include <HAL/Utils/RingBuffer.h>
 
 namespace hal {
 
 class Logger {
  public:
+  /** What LogMessage() does when the queue is full. */
+  enum BackpressurePolicy {
+    /// Wait up to the block timeout for the writer to free a slot.
+    Backpressure_Block,
+    /// Drop the message being logged.
+    Backpressure_DropNewest,
+    /// Evict the oldest queued message to make room.
+    Backpressure_DropOldest,
+    /// Shed low priority streams (camera and lidar by default) as soon as
+    /// the queue eats into the reserve kept for the other streams. Once
+    /// the reserve is used up too, evict the oldest queued message.
+    Backpressure_DropLowPriority
+  };
+
+  /** Payload type (hal::Msg field number) and id of a logged stream. */
+  typedef std::pair<uint32_t, int32_t> StreamId;
+
   static Logger& GetInstance();
 
   Logger();
@@ -29,24 +54,193 @@ class Logger {
   void LogToFile(const std::string &fileName);
   void StopLogging();
   bool IsLogging();
+
+  /** Number of messages which can be queued for writing. Takes effect
+   * the next time a log is started. */
   void SetMaxBufferSize( unsigned int nBufferSize );
   size_t buffer_size() const;
   size_t messages_written() const;
 
+  /** Buffering, preallocation and sync policy of the log file. Takes
+   * effect the next time a log is started. */
+  void SetWriterOptions(const LogWriterOptions& options);
+
+  /** Threads serializing and compressing messages ahead of the writer,
+   * which still writes them in call order. 0 does it all on the writer
+   * thread. Takes effect the next time a log is started. */
+  void SetNumWorkers(unsigned int nWorkers);
+
+  /** Roll over to a new segment file once the current one holds
+   * `nMaxBytes` or has been open for `dMaxSeconds` (0 disables either
+   * limit). With a limit set, the log file becomes a manifest (see
+   * hal::LogManifest) and the segments are written next to it as
+   * <name>_<N><ext>. Takes effect the next time a log is started. */
+  void SetSegmentLimits(uint64_t nMaxBytes, double dMaxSeconds);
+
+  /** Compress image data with the given codec before writing it.
+   * `nLevel` is handed to the codec, 0 picks its default. Images the
+   * codec can't handle are written raw. Takes effect the next time a
+   * log is started. */
+  void SetImageCodec(hal::ImageCodec codec, int nLevel = 0);
+
+  /** Codec used instead for 16-bit single channel (depth) images. */
+  void SetDepthImageCodec(hal::ImageCodec codec, int nLevel = 0);
+
+  /** Store the data of images of at least `nMinBytes`, after any
+   * compression, out of band (see hal::DetachImageBlobs()): as raw
+   * blobs aligned in the log file to the writer's alignment. Memory
+   * mapped readers then get aligned pixels, and they reach the aligned
+   * write buffers with a single copy. 0, the default, keeps image data
+   * inline. Takes effect the next time a log is started. */
+  void SetOutOfBandImages(size_t nMinBytes);
+
+  /** Policy applied when the queue is full. Defaults to
+   * Backpressure_DropNewest. */
+  void SetBackpressurePolicy(BackpressurePolicy ePolicy);
+  BackpressurePolicy backpressure_policy() const;
+
+  /** Longest LogMessage() waits under Backpressure_Block. */
+  void SetBlockTimeout(double dSeconds);
+
+  /** Fraction of the queue low priority streams may not use under
+   * Backpressure_DropLowPriority. Defaults to a quarter. */
+  void SetPriorityReserve(double dFraction);
+
+  /** Mark a payload type (e.g. hal::Msg::kImuFieldNumber) as low priority. */
+  void SetLowPriority(uint32_t nPayloadType, bool bLow);
+
+  /** Messages dropped since the log was started, per stream and total. */
+  std::map<StreamId, size_t> dropped_messages() const;
+  size_t messages_dropped() const;
+
+  /** Largest number of messages queued at once since the log was started. */
+  size_t buffer_high_water_mark() const;
+
+  /** Queue a copy of the message for writing.
+   *
+   * Safe to call from several threads at once. The copy goes into a
+   * preallocated queue slot, reusing the memory of the message which
+   * last occupied it.
+   */
   bool LogMessage(const hal::Msg& message);
 
+  /** Queue the message for writing without copying it.
+   *
+   * The message is swapped into a queue slot. On success `message` is
+   * left holding the cleared contents of that slot, whose buffers the
+   * caller may reuse for its next message. Messages living in an arena,
+   * e.g. those read by hal::Reader, only have their image data swapped
+   * (see hal::MoveMsg()).
+   */
+  bool LogMessage(hal::Msg&& message);
+
  private:
-  void ThreadFunc();
+  /** Settings of a log. The writer and the workers get their own copy
+   * when the log starts: the setters change them for the next log. */
+  struct LogSettings {
+    LogSettings()
+        : segment_max_bytes(0), segment_max_seconds(0), num_workers(0),
+          image_codec(hal::PB_CODEC_NONE), image_codec_level(0),
+          depth_codec(hal::PB_CODEC_NONE), depth_codec_level(0),
+          blob_min_bytes(0) {}
+
+    LogWriterOptions writer_options;
+    uint64_t         segment_max_bytes;
+    double           segment_max_seconds;
+    unsigned int     num_workers;
+    hal::ImageCodec  image_codec;
+    int              image_codec_level;
+    hal::ImageCodec  depth_codec;
+    int              depth_codec_level;
+    size_t           blob_min_bytes;
+  };
+
+  void ThreadFunc(LogSettings settings);
+  void WorkerFunc(const LogSettings& settings);
+
+  /** Stop the writer, if running, and start it on a new log. Must hold
+   * m_StartMutex. */
+  void StartWriter(const std::string& filename);
+
+  /** Stop the writer, if running. Must hold m_StartMutex. */
+  void StopWriter();
+
+  /** Encode and serialize a message, size prefix included, into `pData`.
+   * Leaves `pData` empty if the message can't be serialized. Image data
+   * stored out of band is moved to `pBlobs` instead, and `pData` then
+   * lacks the size prefix, see hal::WriteBlobRecord(). */
+  static void SerializeMessage(
+      const LogSettings& settings, hal::Msg* pMsg, std::string* pData,
+      google::protobuf::RepeatedPtrField<std::string>* pBlobs,
+      hal::LogIndexEntry* pEntry);
+
+  /** Block the writer or a worker until messages are queued. */
+  void WaitForMessages();
+
+  /** Queue a message through `fill` under the backpressure policy. */
+  template <typename Fill>
+  bool QueueMessage(const hal::Msg& message, Fill&& fill);
+
+  bool IsLowPriority(const hal::Msg& message) const;
+
+  /** Compress the images of a message about to be written. */
+  static void EncodeImages(const LogSettings& settings,
+                           hal::CameraMsg* pCameraMsg);
+
+  /** Count a message which was not written. */
+  void CountDrop(const hal::Msg& message);
+
+  /** Wake the writer thread or a worker waiting for messages. */
+  void WakeWriter();
+
+  /** Wake producers blocked on a full queue. */
+  void WakeProducers();
 
  private:
-  std::list<hal::Msg>          m_qMessages;
+  typedef MpmcRingBuffer<hal::Msg> MessageQueue;
+
+  /** Output of a worker, waiting for its turn to be written. */
+  struct SerializedMsg {
+    SerializedMsg() : ready(false) {}
+
+    bool               ready;
+    std::string        data;
+    google::protobuf::RepeatedPtrField<std::string> blobs;
+    hal::LogIndexEntry entry;
+  };
+
+  std::unique_ptr<MessageQueue> m_pQueue;
   std::mutex                  m_QueueMutex;
   std::condition_variable     m_QueueCondition;
+  std::atomic<int>            m_nConsumersWaiting;
   std::string                 m_sFilename;
-  bool                        m_bShouldRun;
+  std::atomic<bool>           m_bShouldRun;
   unsigned int                m_nMaxBufferSize;
+  std::mutex                  m_StartMutex;  // Starting and stopping.
   std::thread                 m_WriteThread;
   std::atomic<size_t>         m_nMessagesWritten;
+  LogSettings                 m_Settings;  // Of the next log.
+
+  std::mutex                  m_PopMutex;
+  uint64_t                    m_nNextSequence;   // Guarded by m_PopMutex.
+  std::mutex                  m_ReorderMutex;
+  std::condition_variable     m_ReorderReady;
+  std::condition_variable     m_ReorderFree;
+  std::vector<SerializedMsg>  m_vReorder;        // Indexed by sequence.
+  uint64_t                    m_nNextToWrite;
+  unsigned int                m_nActiveWorkers;
+
+  BackpressurePolicy          m_ePolicy;
+  double                      m_dBlockTimeout;
+  double                      m_dPriorityReserve;
+  std::atomic<uint32_t>       m_nLowPriorityTypes;  // Bit per payload type.
+  std::mutex                  m_SpaceMutex;
+  std::condition_variable     m_SpaceCondition;
+  std::atomic<int>            m_nProducersWaiting;
+  std::atomic<size_t>         m_nHighWaterMark;
+  std::atomic<size_t>         m_nMessagesDropped;
+  mutable std::mutex          m_DropMutex;
+  std::map<StreamId, size_t>  m_mDropped;
 };
 
 } /* namespace */
@@ -0,0 +1,180 @@
+#include <HAL/Messages/MappedLog.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <initializer_list>
+
+#include <glog/logging.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+namespace hal {
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::internal::WireFormatLite;
+
+namespace {
+
+typedef std::pair<const unsigned char*, size_t> Range;
+
+/// Walk the top level fields of a serialized message. Payloads of the
+/// length delimited fields listed in `fields` are returned in the
+/// matching entry of `vMatches`, every other field is appended verbatim
+/// to `sRest`, which then parses as the message without those fields.
+bool SplitFields(const unsigned char* pData, size_t nSize,
+                 std::initializer_list<int> fields, std::string* sRest,
+                 std::vector<Range>* vMatches) {
+  if (nSize > INT_MAX) {
+    return false;
+  }
+
+  CodedInputStream input(pData, static_cast<int>(nSize));
+  int start = 0;
+  while (uint32_t tag = input.ReadTag()) {
+    const int* pField = std::find(fields.begin(), fields.end(),
+                                  WireFormatLite::GetTagFieldNumber(tag));
+    if (pField != fields.end() &&
+        WireFormatLite::GetTagWireType(tag) ==
+        WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+      uint32_t length;
+      if (!input.ReadVarint32(&length)) {
+        return false;
+      }
+      const int pos = input.CurrentPosition();
+      if (length > nSize - pos || !input.Skip(length)) {
+        return false;
+      }
+      vMatches[pField - fields.begin()].push_back(Range(pData + pos, length));
+    } else {
+      if (!WireFormatLite::SkipField(&input, tag)) {
+        return false;
+      }
+      sRest->append(reinterpret_cast<const char*>(pData) + start,
+                    input.CurrentPosition() - start);
+    }
+    start = input.CurrentPosition();
+  }
+  return input.ConsumedEntireMessage() &&
+      static_cast<size_t>(input.CurrentPosition()) == nSize;
+}
+
+}  // namespace
+
+std::shared_ptr<const MappedFile> MappedFile::Open(
+    const std::string& sFilename) {
+  int fd = open(sFilename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return nullptr;
+  }
+
+  void* pData = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (pData == MAP_FAILED) {
+    LOG(WARNING) << "HAL: Could not memory map '" << sFilename << "'.";
+    return nullptr;
+  }
+
+  // Logs are replayed front to back: ask for aggressive read-ahead.
+  madvise(pData, st.st_size, MADV_SEQUENTIAL);
+
+  return std::shared_ptr<const MappedFile>(
+      new MappedFile(static_cast<const unsigned char*>(pData), st.st_size));
+}
+
+MappedFile::~MappedFile() {
+  munmap(const_cast<unsigned char*>(m_pData), m_nSize);
+}
+
+bool ParseMsgWithoutImageData(const unsigned char* pData, size_t nSize,
+                              hal::Msg* msg, std::vector<ImageView>* views) {
+  msg->Clear();
+  views->clear();
+
+  // Padding in front of blobs is dropped along with them.
+  std::string rest;
+  std::vector<Range> fields[3];
+  const std::vector<Range>& cameras = fields[0];
+  const std::vector<Range>& blobs = fields[1];
+  if (!SplitFields(pData, nSize, {hal::Msg::kCameraFieldNumber,
+                                  hal::Msg::kBlobFieldNumber,
+                                  hal::Msg::kBlobPaddingFieldNumber},
+                   &rest, fields) ||
+      !msg->ParseFromString(rest)) {
+    return false;
+  }
+
+  for (const Range& camera : cameras) {
+    rest.clear();
+    std::vector<Range> images;
+    hal::CameraMsg* pCamera = msg->mutable_camera();
+    if (!SplitFields(camera.first, camera.second,
+                     {hal::CameraMsg::kImageFieldNumber}, &rest, &images) ||
+        !pCamera->MergeFromString(rest)) {
+      return false;
+    }
+
+    for (const Range& image : images) {
+      rest.clear();
+      std::vector<Range> data;
+      hal::ImageMsg* pImage = pCamera->add_image();
+      if (!SplitFields(image.first, image.second,
+                       {hal::ImageMsg::kDataFieldNumber}, &rest, &data) ||
+          !pImage->ParseFromString(rest)) {
+        return false;
+      }
+
+      if (pImage->has_blob()) {
+        if (pImage->blob() >= blobs.size()) {
+          return false;
+        }
+        const Range& blob = blobs[pImage->blob()];
+        views->push_back(ImageView(blob.first, blob.second));
+        pImage->clear_blob();
+      } else {
+        // As when parsing, the last occurrence of a field wins.
+        views->push_back(data.empty() ? ImageView() :
+                         ImageView(data.back().first, data.back().second));
+      }
+    }
+  }
+  return true;
+}
+
+MappedCameraMsg::MappedCameraMsg(std::shared_ptr<hal::Msg> msg,
+                                 std::vector<ImageView> views,
+                                 std::shared_ptr<const MappedFile> file)
+    : m_pMsg(std::move(msg)), m_vViews(std::move(views)),
+      m_pFile(std::move(file)) {
+  // Images without a view, e.g. when not memory mapped or decompressed,
+  // keep their data in the message itself.
+  const hal::CameraMsg& camera = m_pMsg->camera();
+  m_vViews.resize(camera.image_size());
+  for (int ii = 0; ii < camera.image_size(); ++ii) {
+    if (!m_pFile || m_vViews[ii].data == nullptr) {
+      const std::string& data = camera.image(ii).data();
+      m_vViews[ii] = ImageView(
+          reinterpret_cast<const unsigned char*>(data.data()), data.size());
+    }
+  }
+}
+
+void MappedCameraMsg::CopyTo(hal::CameraMsg* out) const {
+  out->CopyFrom(m_pMsg->camera());
+  for (int ii = 0; ii < out->image_size() && ii < NumImages(); ++ii) {
+    out->mutable_image(ii)->set_data(ImageData(ii), ImageSize(ii));
+  }
+}
+
+}  // namespace hal
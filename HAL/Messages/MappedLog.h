@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <HAL/Messages.pb.h>
+
+namespace hal {
+
+/// Read-only memory mapping of a whole file. Shared by everything that
+/// points into it, and unmapped when the last reference goes away.
+class MappedFile {
+ public:
+  /// Map the given file. Returns null if it can't be opened or mapped.
+  static std::shared_ptr<const MappedFile> Open(const std::string& sFilename);
+
+  ~MappedFile();
+
+  const unsigned char* data() const { return m_pData; }
+  size_t size() const { return m_nSize; }
+
+ private:
+  MappedFile(const unsigned char* pData, size_t nSize)
+      : m_pData(pData), m_nSize(nSize) {}
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const unsigned char* m_pData;
+  size_t               m_nSize;
+};
+
+/// Location of an image's pixel data.
+struct ImageView {
+  ImageView() : data(nullptr), size(0) {}
+  ImageView(const unsigned char* d, size_t s) : data(d), size(s) {}
+
+  const unsigned char* data;
+  size_t               size;
+};
+
+/// Parse a serialized hal::Msg without copying the pixel data of its
+/// camera images: they are left empty in `msg` and their location in
+/// the buffer is returned in `views`, one per image. Images stored out
+/// of band (see hal::DetachImageBlobs()) point at their blob.
+bool ParseMsgWithoutImageData(const unsigned char* pData, size_t nSize,
+                              hal::Msg* msg, std::vector<ImageView>* views);
+
+/**
+ * Camera message whose pixel data is not owned by the message itself.
+ *
+ * Handed out by hal::Reader::ReadMappedCameraMsg(). When the reader is
+ * memory mapped, the image data points straight into the mapped log
+ * and the mapping stays alive for as long as this handle does. Image
+ * fields other than data are available through Msg(). Compressed
+ * images are decoded into Msg() instead.
+ */
+class MappedCameraMsg {
+ public:
+  MappedCameraMsg(std::shared_ptr<hal::Msg> msg,
+                  std::vector<ImageView> views,
+                  std::shared_ptr<const MappedFile> file);
+
+  /// The camera message. Images read from the mapping carry no data.
+  const hal::CameraMsg& Msg() const { return m_pMsg->camera(); }
+
+  int NumImages() const { return static_cast<int>(m_vViews.size()); }
+  const unsigned char* ImageData(int idx) const { return m_vViews[idx].data; }
+  size_t ImageSize(int idx) const { return m_vViews[idx].size; }
+
+  /// Copy the message, image data included, into `out`.
+  void CopyTo(hal::CameraMsg* out) const;
+
+ private:
+  std::shared_ptr<hal::Msg>         m_pMsg;
+  std::vector<ImageView>            m_vViews;
+  std::shared_ptr<const MappedFile> m_pFile;
+};
+
+}  // namespace hal
@@ -0,0 +1,85 @@
+#include <HAL/Messages/MsgArena.h>
+
+#include <string>
+#include <vector>
+
+namespace hal {
+
+namespace {
+
+/// Blocks of the arenas. Small enough for a batch of IMU messages to
+/// fit in a few, large enough to hold the fields of camera messages.
+const size_t kArenaStartBlockSize = 16 << 10;
+const size_t kArenaMaxBlockSize = 256 << 10;
+
+void TakeImageData(hal::CameraMsg* pCamera, std::vector<std::string>* vData) {
+  vData->resize(pCamera->image_size());
+  for (int ii = 0; ii < pCamera->image_size(); ++ii) {
+    (*vData)[ii].swap(*pCamera->mutable_image(ii)->mutable_data());
+  }
+}
+
+void GiveImageData(hal::CameraMsg* pCamera, std::vector<std::string>* vData) {
+  for (int ii = 0; ii < pCamera->image_size() &&
+           ii < static_cast<int>(vData->size()); ++ii) {
+    (*vData)[ii].swap(*pCamera->mutable_image(ii)->mutable_data());
+  }
+}
+
+}  // namespace
+
+MsgArena::MsgArena(size_t nBatchMessages, size_t nBatchBytes)
+    : m_nBatchMessages(nBatchMessages), m_nBatchBytes(nBatchBytes),
+      m_nMessages(0), m_nBytes(0) {}
+
+std::shared_ptr<hal::Msg> MsgArena::NewMsg(size_t nBytes) {
+  if (!m_pArena || m_nMessages >= m_nBatchMessages ||
+      m_nBytes >= m_nBatchBytes) {
+    google::protobuf::ArenaOptions options;
+    options.start_block_size = kArenaStartBlockSize;
+    options.max_block_size = kArenaMaxBlockSize;
+    m_pArena = std::make_shared<google::protobuf::Arena>(options);
+    m_nMessages = 0;
+    m_nBytes = 0;
+  }
+
+  ++m_nMessages;
+  m_nBytes += nBytes;
+  hal::Msg* pMsg =
+      google::protobuf::Arena::CreateMessage<hal::Msg>(m_pArena.get());
+  return std::shared_ptr<hal::Msg>(m_pArena, pMsg);
+}
+
+void MoveMsg(hal::Msg* pFrom, hal::Msg* pTo) {
+  if (pFrom->GetArena() == pTo->GetArena()) {
+    pTo->Swap(pFrom);
+    pFrom->Clear();
+    return;
+  }
+
+  std::vector<std::string> vData;
+  if (pFrom->has_camera()) {
+    TakeImageData(pFrom->mutable_camera(), &vData);
+  }
+  pTo->CopyFrom(*pFrom);
+  if (pTo->has_camera()) {
+    GiveImageData(pTo->mutable_camera(), &vData);
+  }
+  pFrom->Clear();
+}
+
+void MoveCameraMsg(hal::CameraMsg* pFrom, hal::CameraMsg* pTo) {
+  if (pFrom->GetArena() == pTo->GetArena()) {
+    pTo->Swap(pFrom);
+    pFrom->Clear();
+    return;
+  }
+
+  std::vector<std::string> vData;
+  TakeImageData(pFrom, &vData);
+  pTo->CopyFrom(*pFrom);
+  GiveImageData(pTo, &vData);
+  pFrom->Clear();
+}
+
+}  // namespace hal
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <memory>
+
+#include <google/protobuf/arena.h>
+
+#include <HAL/Messages.pb.h>
+
+namespace hal {
+
+/**
+ * Allocates messages in protobuf arenas, one arena per batch.
+ *
+ * A message and all its submessages come out of a few arena blocks
+ * shared with the rest of the batch rather than an allocation each, and
+ * are freed together with the arena. The handles returned keep their
+ * batch's arena alive: it is freed once the next batch has started and
+ * every message of it has been released.
+ *
+ * Not thread safe. Use one per thread, e.g. per decode thread.
+ */
+class MsgArena {
+ public:
+  /// Start a new batch after `nBatchMessages` messages, or once the
+  /// batch holds about `nBatchBytes` of messages, so a few held on to
+  /// large camera messages don't keep many others alive.
+  explicit MsgArena(size_t nBatchMessages = 256, size_t nBatchBytes = 1 << 20);
+
+  /// New empty message in the current batch. `nBytes` is its expected
+  /// (e.g. serialized) size, counted against the batch.
+  std::shared_ptr<hal::Msg> NewMsg(size_t nBytes = 0);
+
+ private:
+  std::shared_ptr<google::protobuf::Arena> m_pArena;
+  size_t                                   m_nBatchMessages;
+  size_t                                   m_nBatchBytes;
+  size_t                                   m_nMessages;
+  size_t                                   m_nBytes;
+};
+
+/// Handle to a part of a message, e.g. its camera message, which keeps
+/// the whole message, and the arena it lives in, alive.
+template <typename T>
+std::shared_ptr<T> SubMsgHandle(const std::shared_ptr<hal::Msg>& pMsg,
+                                T* pSubMsg) {
+  return std::shared_ptr<T>(pMsg, pSubMsg);
+}
+
+/// Move a message into one which may live on another arena, or on the
+/// heap. Swap() copies across arenas; this swaps the image data instead
+/// and only copies the remaining, small, fields. Leaves `pFrom` cleared.
+void MoveMsg(hal::Msg* pFrom, hal::Msg* pTo);
+void MoveCameraMsg(hal::CameraMsg* pFrom, hal::CameraMsg* pTo);
+
+}  // namespace hal
@@ -1,20 +1,160 @@
+#include <stdlib.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <climits>
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include <stdexcept>
 
 #include <HAL/config.h>
 
 #include "Reader.h"
+#include <HAL/Messages/ImageCodec.h>
+#include <HAL/Messages/LogBlob.h>
 
 #include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include <google/protobuf/io/coded_stream.h>
 #include <glog/logging.h>
 
 namespace hal {
 
+namespace {
+
+/// Locate the record starting at *nPos in a mapped log and advance
+/// *nPos past it.
+bool NextMappedRecord(const MappedFile& file, size_t* nPos,
+                      const unsigned char** pRecord, uint32_t* nRecordSize) {
+  if( *nPos >= file.size() ) {
+    return false;
+  }
+
+  const size_t nAvailable = file.size() - *nPos;
+  google::protobuf::io::CodedInputStream coded_input(
+      file.data() + *nPos, std::min<size_t>(nAvailable, 16));
+  uint32_t msg_size_bytes;
+  if( !coded_input.ReadVarint32(&msg_size_bytes) ) {
+    return false;
+  }
+
+  const size_t nPrefix = coded_input.CurrentPosition();
+  if( msg_size_bytes > nAvailable - nPrefix ) {
+    std::cerr << "HAL: Log ends in a truncated message." << std::endl;
+    return false;
+  }
+
+  *pRecord = file.data() + *nPos + nPrefix;
+  *nRecordSize = msg_size_bytes;
+  *nPos += nPrefix + msg_size_bytes;
+  return true;
+}
+
+/// Decode compressed images of a mapped message into the message itself.
+/// Their views are reset: the data no longer lives in the mapping.
+void DecodeMappedImages(hal::Msg* pMsg, std::vector<ImageView>* vViews) {
+  if( !pMsg->has_camera() ) {
+    return;
+  }
+
+  hal::CameraMsg* pCamera = pMsg->mutable_camera();
+  for( int ii = 0; ii < pCamera->image_size() &&
+           ii < static_cast<int>(vViews->size()); ++ii ) {
+    hal::ImageMsg* pImage = pCamera->mutable_image(ii);
+    if( pImage->codec() == hal::PB_CODEC_NONE ) {
+      continue;
+    }
+
+    const ImageView& view = (*vViews)[ii];
+    if( DecodeImageData(*pImage, view.data, view.size,
+                        pImage->mutable_data()) ) {
+      pImage->clear_codec();
+      pImage->clear_raw_size();
+    } else {
+      std::cerr << "HAL: Could not decode "
+                << hal::ImageCodec_Name(pImage->codec()) << " image."
+                << std::endl;
+      pImage->set_data(view.data, view.size);
+    }
+    (*vViews)[ii] = ImageView();
+  }
+}
+
+/// Parse a record of a mapped log, leaving uncompressed image data in
+/// the mapping. `pViewFile` is set if any image data was left there.
+bool ParseMappedRecord(const std::shared_ptr<const MappedFile>& pFile,
+                       const unsigned char* pRecord, uint32_t nRecordSize,
+                       hal::Msg* pMsg, std::vector<ImageView>* vViews,
+                       std::shared_ptr<const MappedFile>* pViewFile) {
+  if( !ParseMsgWithoutImageData(pRecord, nRecordSize, pMsg, vViews) ) {
+    return false;
+  }
+  DecodeMappedImages(pMsg, vViews);
+
+  // Messages without views don't need the mapping kept alive.
+  pViewFile->reset();
+  for( const ImageView& view : *vViews ) {
+    if( view.data != nullptr ) {
+      *pViewFile = pFile;
+      break;
+    }
+  }
+  return true;
+}
+
+/// True for the index and trailer records closing a log. Only looks at
+/// the record's fields, not into them.
+bool IsFooterRecord(const unsigned char* pRecord, uint32_t nRecordSize) {
+  google::protobuf::io::CodedInputStream coded_input(pRecord, nRecordSize);
+  LogIndexEntry entry;
+  return ReadLogRecordInfo(&coded_input, nRecordSize, &entry) &&
+      IsLogFooter(entry);
+}
+
+/// Readers handed out by Reader::Open(), by canonical path.
+std::mutex& OpenReadersMutex() {
+  static std::mutex s_mutex;
+  return s_mutex;
+}
+
+std::map<std::string, std::weak_ptr<Reader> >& OpenReaders() {
+  static std::map<std::string, std::weak_ptr<Reader> > s_readers;
+  return s_readers;
+}
+
+}  // namespace
+
+std::shared_ptr<Reader> Reader::Open(const std::string& filename,
+                                     MessageType eType) {
+  std::string sKey = filename;
+  char* pPath = realpath(filename.c_str(), nullptr);
+  if( pPath ) {
+    sKey = pPath;
+    free(pPath);
+  }
+
+  std::lock_guard<std::mutex> lock(OpenReadersMutex());
+  std::map<std::string, std::weak_ptr<Reader> >& readers = OpenReaders();
+  std::shared_ptr<Reader> pReader = readers[sKey].lock();
+  if( !pReader ) {
+    pReader = std::make_shared<Reader>(filename);
+    readers[sKey] = pReader;
+
+    // Forget readers which were closed since.
+    for( auto it = readers.begin(); it != readers.end(); ) {
+      if( it->second.expired() ) {
+        it = readers.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  pReader->Enable(eType);
+  return pReader;
+}
+
 Reader& Reader::Instance( const std::string& filename, MessageType eType ) {
   static Reader m_Instance(filename);
   if( eType == Msg_Type_Camera ) {
@@ -38,28 +178,80 @@ Reader::Reader(const std::string& filename) : m_bRunning(true),
                                               m_bReadIMU(false),
                                               m_bReadLIDAR(false),
                                               m_bReadPosys(false),
+                                              m_bMemoryMapped(false),
+                                              m_bCamerasById(false),
+                                              m_nNextSequence(0),
+                                              m_bStarted(false),
+                                              m_bConfigured(false),
+                                              m_nInitialSegment(0),
                                               m_nInitialImageID(0),
-  m_nMaxBufferSize(10) {
+                                              m_nInitialOffset(0),
+                                              m_nIndexSegment(0),
+  m_nMaxBufferSize(10),
+  m_vMaxBufferSize(Msg_Type_Posys + 1, m_nMaxBufferSize),
+  m_nDecodeThreads(0),
+  m_nDecoders(0),
+  m_nNextRecord(0),
+  m_nNextToQueue(0),
+  m_bFramingDone(false) {
   _BufferFromFile(filename);
 }
 
-bool Reader::_AmINext(MessageType eMsgType) {
-  if( m_qMessageTypes.empty() ) {
-    return false;
-  }
-
-  return m_qMessageTypes.front() == eMsgType;
-}
-
 Reader::~Reader() {
   StopBuffering();
 }
 
 void Reader::_ThreadFunc() {
-  int fd = open(m_sFilename.c_str(), O_RDONLY);
+  std::vector<std::thread> decoders;
+  m_nDecoders = m_nDecodeThreads;
+  if( m_nDecoders > 0 ) {
+    {
+      std::lock_guard<std::mutex> lock(m_DecodeMutex);
+      m_qRecords.clear();
+      m_nNextRecord = 0;
+      m_nNextToQueue = 0;
+      m_bFramingDone = false;
+    }
+    for( unsigned int ii = 0; ii < m_nDecoders; ++ii ) {
+      decoders.emplace_back(&Reader::_DecodeFunc, this);
+    }
+  }
+
+  // Segments of a log follow on from each other.
+  for( size_t nSegment = m_nInitialSegment;
+       m_bShouldRun && nSegment < _NumSegments(); ++nSegment ) {
+    const bool bFirst = (nSegment == m_nInitialSegment);
+    const size_t nInitialImageID = bFirst ? m_nInitialImageID : 0;
+    const uint64_t nInitialOffset = bFirst ? m_nInitialOffset : 0;
+    if( m_bMemoryMapped ) {
+      _ReadMappedLog(_SegmentPath(nSegment), nInitialImageID, nInitialOffset);
+    } else {
+      _ReadLog(_SegmentPath(nSegment), nInitialImageID, nInitialOffset);
+    }
+  }
+
+  if( !decoders.empty() ) {
+    {
+      std::lock_guard<std::mutex> lock(m_DecodeMutex);
+      m_bFramingDone = true;
+    }
+    m_DecodeQueued.notify_all();
+    for( std::thread& decoder : decoders ) {
+      decoder.join();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(m_QueueMutex);
+  m_bRunning = false;
+  _NotifyReaders();
+}
+
+void Reader::_ReadLog(const std::string& sFilename, size_t nInitialImageID,
+                      uint64_t nInitialOffset) {
+  int fd = open(sFilename.c_str(), O_RDONLY);
 
   if(fd == -1) {
-    std::cerr << "HAL: File '"<< m_sFilename
+    std::cerr << "HAL: File '"<< sFilename
               << "' could not be opened. Does it exist?" << std::endl;
     return;
   }
@@ -77,7 +269,7 @@ void Reader::_ThreadFunc() {
 
   if( magic_number[0] != '%' || magic_number[1] != 'H' ||
       magic_number[2] != 'A' || magic_number[3] != 'L' ) {
-    std::cerr << "HAL: File '"<< m_sFilename
+    std::cerr << "HAL: File '"<< sFilename
               << "' not in expected format (wrong magic number)." << std::endl;
     return;
   }
@@ -111,10 +303,40 @@ void Reader::_ThreadFunc() {
   }
 
 
-  ///-------------------- Read Message Log
+  ///-------------------- Seek to Initial Message
   size_t nImgID = 0;
-  m_bRunning = true;
+  if( nInitialOffset > 0 ) {
+    // Offset comes from the index: jump straight to it.
+    uint64_t skip = nInitialOffset - raw_input.ByteCount();
+    while( skip > 0 ) {
+      const int count = std::min<uint64_t>(skip, INT_MAX);
+      if( !raw_input.Skip(count) ) {
+        std::cerr << "HAL: Error while seeking to message "
+                  << nInitialImageID << "." << std::endl;
+        return;
+      }
+      skip -= count;
+    }
+    nImgID = nInitialImageID;
+  }
+
+  // Without an index step over the preceding records, reading only
+  // their sizes.
+  while( m_bShouldRun && nImgID < nInitialImageID ) {
+    google::protobuf::io::CodedInputStream coded_input(&raw_input);
 
+    uint32_t msg_size_bytes;
+    if( !coded_input.ReadVarint32(&msg_size_bytes) ||
+        !coded_input.Skip(msg_size_bytes) ) {
+      std::cerr << "HAL: Log ended before message "
+                << nInitialImageID << "." << std::endl;
+      break;
+    }
+    nImgID++;
+  }
+
+  ///-------------------- Read Message Log
+  MsgArena arena;
   while( m_bShouldRun ){
     google::protobuf::io::CodedInputStream coded_input(&raw_input);
 
@@ -125,9 +347,25 @@ void Reader::_ThreadFunc() {
       break;
     }
 
+    // Leave parsing to the decode threads.
+    if( m_nDecoders > 0 ) {
+      RawRecord record;
+      if( !coded_input.ReadString(&record.data, msg_size_bytes) ) {
+        std::cerr << "HAL: Log ends in a truncated message." << std::endl;
+        break;
+      }
+      const unsigned char* pRecord =
+          reinterpret_cast<const unsigned char*>(record.data.data());
+      if( IsFooterRecord(pRecord, msg_size_bytes) ||
+          !_QueueRecord(std::move(record)) ) {
+        break;
+      }
+      continue;
+    }
+
     google::protobuf::io::CodedInputStream::Limit lim =
         coded_input.PushLimit(msg_size_bytes);
-    std::unique_ptr<hal::Msg> pMsg(new hal::Msg);
+    std::shared_ptr<hal::Msg> pMsg = arena.NewMsg(msg_size_bytes);
 //      This error message is inaccurate, so squelching it for now.
     if( !pMsg->ParseFromCodedStream(&coded_input) ) {
 //      std::cerr << "HAL: Error while parsing from coded stream. "
@@ -136,221 +374,645 @@ void Reader::_ThreadFunc() {
     }
     coded_input.PopLimit(lim);
 
-    // Wait if buffer is full, then add to queue
-    std::unique_lock<std::mutex> lock(m_QueueMutex);
-    while(m_bShouldRun && m_qMessages.size() >= m_nMaxBufferSize){
-      m_ConditionDequeued.wait_for(lock, std::chrono::milliseconds(10) );
+    if( pMsg->blob_size() > 0 && !AttachImageBlobs(pMsg.get()) ) {
+      std::cerr << "HAL: Message refers to missing image data." << std::endl;
+    }
+    if( pMsg->has_camera() && !DecodeCameraMsg(pMsg->mutable_camera()) ) {
+      std::cerr << "HAL: Could not decode all images of a message."
+                << std::endl;
+    }
+
+    if( !_Enqueue(std::move(pMsg), std::vector<ImageView>(), nullptr) ) {
+      break;
+    }
+  }
+}
+
+void Reader::_ReadMappedLog(const std::string& sFilename,
+                            size_t nInitialImageID, uint64_t nInitialOffset) {
+  std::shared_ptr<const MappedFile> pFile = MappedFile::Open(sFilename);
+  if( !pFile ) {
+    std::cerr << "HAL: File '"<< sFilename
+              << "' could not be memory mapped. Does it exist?" << std::endl;
+    return;
+  }
+
+  ///-------------------- Read Magic Number and Header Message
+  google::protobuf::io::ArrayInputStream header_input(
+      pFile->data(), std::min<size_t>(pFile->size(), INT_MAX));
+  if( !ReadLogHeader(&header_input, &m_Header) ) {
+    std::cerr << "HAL: File '"<< sFilename
+              << "' not in expected format." << std::endl;
+    return;
+  }
+
+  // check if version numbers match
+  if( m_Header.version() != Messages_VERSION ) {
+    std::cerr << "HAL: Log was recorded using a different "
+              << "Messages version and it is unreadable!" << std::endl;
+    return;
+  }
+
+  ///-------------------- Seek to Initial Message
+  size_t nPos = header_input.ByteCount();
+  size_t nImgID = 0;
+  if( nInitialOffset > 0 ) {
+    nPos = nInitialOffset;
+    nImgID = nInitialImageID;
+  }
+
+  const unsigned char* pRecord;
+  uint32_t nRecordSize;
+  while( m_bShouldRun && nImgID < nInitialImageID ) {
+    if( !NextMappedRecord(*pFile, &nPos, &pRecord, &nRecordSize) ) {
+      std::cerr << "HAL: Log ended before message "
+                << nInitialImageID << "." << std::endl;
+      break;
+    }
+    nImgID++;
+  }
+
+  ///-------------------- Read Message Log
+  MsgArena arena;
+  while( m_bShouldRun ) {
+    if( !NextMappedRecord(*pFile, &nPos, &pRecord, &nRecordSize) ) {
+      // Probably end of file.
+      std::cerr << "HAL: Error while reading message size." << std::endl;
+      break;
     }
 
-    if( nImgID < m_nInitialImageID ) {
-      nImgID++;
+    // Leave parsing to the decode threads.
+    if( m_nDecoders > 0 ) {
+      RawRecord record;
+      record.record = pRecord;
+      record.size = nRecordSize;
+      record.file = pFile;
+      if( IsFooterRecord(pRecord, nRecordSize) ||
+          !_QueueRecord(std::move(record)) ) {
+        break;
+      }
       continue;
     }
 
-    bool has_camera  = pMsg->has_camera();
-    bool has_imu     = pMsg->has_imu();
-    bool has_lidar   = pMsg->has_lidar();
-    bool has_pose    = pMsg->has_pose();
+    std::shared_ptr<hal::Msg> pMsg = arena.NewMsg(nRecordSize);
+    std::vector<ImageView> vViews;
+    std::shared_ptr<const MappedFile> pViewFile;
+    if( !ParseMappedRecord(pFile, pRecord, nRecordSize, pMsg.get(), &vViews,
+                           &pViewFile) ) {
+      break;
+    }
 
-    int num_message_types =
-        (has_camera + has_imu + has_lidar + has_pose);
-    if (num_message_types == 0) {
-      LOG(WARNING) << "Message with no known data types found";
-    } else if (num_message_types > 1) {
-      LOG(ERROR) << "Message with more than one data type found.";
+    if( !_Enqueue(std::move(pMsg), std::move(vViews), std::move(pViewFile)) ) {
+      break;
     }
+  }
+}
+
+bool Reader::_QueueRecord(RawRecord record) {
+  std::unique_lock<std::mutex> lock(m_DecodeMutex);
+  m_DecodeSpace.wait(lock, [this]() {
+      return !m_bShouldRun || m_qRecords.size() < 4 * m_nDecoders;
+    });
+  if( !m_bShouldRun ) {
+    return false;
+  }
+
+  record.seq = m_nNextRecord++;
+  m_qRecords.push_back(std::move(record));
+  lock.unlock();
+  m_DecodeQueued.notify_one();
+  return true;
+}
 
-    MessageType msg_type;
-    if (has_camera) {
-      msg_type = Msg_Type_Camera;
-    } else if (has_imu) {
-      msg_type = Msg_Type_IMU;
-    } else if (has_lidar) {
-      msg_type = Msg_Type_LIDAR;
-    } else if (has_pose) {
-      msg_type = Msg_Type_Posys;
+void Reader::_DecodeFunc() {
+  MsgArena arena;
+  RawRecord record;
+  while( true ) {
+    {
+      std::unique_lock<std::mutex> lock(m_DecodeMutex);
+      m_DecodeQueued.wait(lock, [this]() {
+          return !m_qRecords.empty() || m_bFramingDone;
+        });
+      if( m_qRecords.empty() ) {
+        break;
+      }
+      record = std::move(m_qRecords.front());
+      m_qRecords.pop_front();
+    }
+    m_DecodeSpace.notify_one();
+
+    // Mapped image data isn't part of the message, so isn't counted.
+    std::shared_ptr<hal::Msg> pMsg =
+        arena.NewMsg(record.file ? record.size : record.data.size());
+    std::vector<ImageView> vViews;
+    std::shared_ptr<const MappedFile> pViewFile;
+    bool bParsed;
+    if( record.file ) {
+      bParsed = ParseMappedRecord(record.file, record.record, record.size,
+                                  pMsg.get(), &vViews, &pViewFile);
+    } else {
+      bParsed = pMsg->ParseFromString(record.data);
+      if( bParsed && pMsg->blob_size() > 0 &&
+          !AttachImageBlobs(pMsg.get()) ) {
+        std::cerr << "HAL: Message refers to missing image data."
+                  << std::endl;
+      }
+      if( bParsed && pMsg->has_camera() &&
+          !DecodeCameraMsg(pMsg->mutable_camera()) ) {
+        std::cerr << "HAL: Could not decode all images of a message."
+                  << std::endl;
+      }
+    }
+    if( !bParsed ) {
+      std::cerr << "HAL: Skipping a message which could not be parsed."
+                << std::endl;
     }
 
-    if ((has_camera  && m_bReadCamera)  ||
-        (has_imu     && m_bReadIMU)     ||
-        (has_lidar   && m_bReadLIDAR)   ||
-        (has_pose    && m_bReadPosys)) {
-      m_qMessageTypes.push_back(msg_type);
-      m_qMessages.push_back(std::move(pMsg));
-      m_ConditionQueued.notify_one();
+    // Queue in log order. Whoever holds the turn may block on a full
+    // stream, which holds up the others just like a single thread.
+    std::unique_lock<std::mutex> lock(m_DecodeMutex);
+    m_DecodeTurn.wait(lock, [&]() { return m_nNextToQueue == record.seq; });
+    lock.unlock();
+
+    if( bParsed ) {
+      _Enqueue(std::move(pMsg), std::move(vViews), std::move(pViewFile));
     }
+    record.file.reset();
+
+    lock.lock();
+    ++m_nNextToQueue;
+    lock.unlock();
+    m_DecodeTurn.notify_all();
   }
+}
 
-  m_bRunning = false;
+bool Reader::_Enqueue(std::shared_ptr<hal::Msg> pMsg,
+                      std::vector<ImageView> vViews,
+                      std::shared_ptr<const MappedFile> pFile) {
+  // The index footer closes the log file.
+  if( pMsg->has_index() || pMsg->has_trailer() ) {
+    return false;
+  }
+
+  bool has_camera  = pMsg->has_camera();
+  bool has_imu     = pMsg->has_imu();
+  bool has_lidar   = pMsg->has_lidar();
+  bool has_pose    = pMsg->has_pose();
+
+  int num_message_types =
+      (has_camera + has_imu + has_lidar + has_pose);
+  if (num_message_types == 0) {
+    LOG(WARNING) << "Message with no known data types found";
+    return true;
+  } else if (num_message_types > 1) {
+    LOG(ERROR) << "Message with more than one data type found.";
+  }
+
+  MessageType msg_type;
+  if (has_camera) {
+    msg_type = Msg_Type_Camera;
+  } else if (has_imu) {
+    msg_type = Msg_Type_IMU;
+  } else if (has_lidar) {
+    msg_type = Msg_Type_LIDAR;
+  } else {
+    msg_type = Msg_Type_Posys;
+  }
+
+  if (!IsEnabled(msg_type)) {
+    return true;
+  }
+
+  const StreamKey key(msg_type, has_camera ? pMsg->camera().id() : -1);
+
+  // Wait if the stream's buffer is full, then add to its queue
+  std::unique_lock<std::mutex> lock(m_QueueMutex);
+  if( !_IsRead(key) ) {
+    return true;
+  }
+  Stream& stream = m_mStreams[key];
+  m_ConditionDequeued.wait(lock, [&]() {
+      return !m_bShouldRun || !_IsRead(key) ||
+          stream.queue.size() < m_vMaxBufferSize[msg_type];
+    });
+  if( !m_bShouldRun ) {
+    return false;
+  }
+  if( !_IsRead(key) ) {
+    return true;
+  }
+
+  stream.queue.emplace_back();
+  QueuedMsg& queued = stream.queue.back();
+  queued.seq = m_nNextSequence++;
+  queued.msg = std::move(pMsg);
+  queued.views = std::move(vViews);
+  queued.file = std::move(pFile);
+
+  stream.queued.notify_one();
+  m_ConditionQueued.notify_all();
+  return true;
+}
+
+bool Reader::_IsRead(const StreamKey& key) const {
+  if( !IsEnabled(key.first) ) {
+    return false;
+  }
+  // Without cameras enabled by id, every camera is read.
+  return key.first != Msg_Type_Camera || !m_bCamerasById ||
+      m_sCameraReaders.count(-1) > 0 ||
+      m_sCameraReaders.count(key.second) > 0;
 }
 
-std::unique_ptr<hal::Msg> Reader::ReadMessage() {
-  // Wait if buffer is empty
+void Reader::_DropUnreadCameras() {
+  for( auto& it : m_mStreams ) {
+    if( it.first.first == Msg_Type_Camera && !_IsRead(it.first) ) {
+      it.second.queue.clear();
+    }
+  }
+  _NotifyReaders();
+  m_ConditionDequeued.notify_all();
+}
+
+bool Reader::_Pop(int nType, int nId, QueuedMsg* pNext) {
+  _StartThread();
+
   std::unique_lock<std::mutex> lock(m_QueueMutex);
-  while( m_bRunning && m_qMessages.empty() ){
-    m_ConditionQueued.wait_for(lock, std::chrono::milliseconds(10));
+  const bool bOneStream = nType >= 0 && (nType != Msg_Type_Camera || nId >= 0);
+  const StreamKey key(static_cast<MessageType>(std::max(nType, 0)), nId);
+  Stream* pOneStream = nullptr;
+  if( bOneStream ) {
+    pOneStream = &m_mStreams[key];
   }
 
-  if(!m_qMessages.empty()) {
-    std::unique_ptr<hal::Msg> pMessage = std::move(m_qMessages.front());
-    m_qMessages.pop_front();
-    m_qMessageTypes.pop_front();
-    m_ConditionDequeued.notify_one();
-    return pMessage;
-  }else{
+  while( true ) {
+    // Otherwise take the stream whose front comes first in the log.
+    Stream* pStream = pOneStream;
+    if( !bOneStream ) {
+      for( auto& it : m_mStreams ) {
+        std::deque<QueuedMsg>& queue = it.second.queue;
+        if( (nType < 0 || it.first.first == nType) && !queue.empty() &&
+            (!pStream || queue.front().seq < pStream->queue.front().seq) ) {
+          pStream = &it.second;
+        }
+      }
+    }
+
+    // Messages left when the log ended are still handed out.
+    if( pStream && !pStream->queue.empty() ) {
+      *pNext = std::move(pStream->queue.front());
+      pStream->queue.pop_front();
+      m_ConditionDequeued.notify_one();
+      return true;
+    }
+
+    if( !m_bRunning ||
+        (nType >= 0 && !IsEnabled(static_cast<MessageType>(nType))) ||
+        (bOneStream && !_IsRead(key)) ) {
+      return false;
+    }
+
+    if( bOneStream ) {
+      pOneStream->queued.wait(lock);
+    } else {
+      m_ConditionQueued.wait(lock);
+    }
+  }
+}
+
+void Reader::_NotifyReaders() {
+  for( auto& it : m_mStreams ) {
+    it.second.queued.notify_all();
+  }
+  m_ConditionQueued.notify_all();
+}
+
+void Reader::_AttachImageData(const std::vector<ImageView>& vViews,
+                              hal::CameraMsg* pCameraMsg) {
+  for( int ii = 0; ii < pCameraMsg->image_size() &&
+           ii < static_cast<int>(vViews.size()); ++ii ) {
+    // Decoded images already hold their data.
+    if( vViews[ii].data != nullptr ) {
+      pCameraMsg->mutable_image(ii)->set_data(vViews[ii].data,
+                                              vViews[ii].size);
+    }
+  }
+}
+
+std::shared_ptr<hal::Msg> Reader::ReadMessage() {
+  QueuedMsg next;
+  if( !_Pop(-1, -1, &next) ) {
     return nullptr;
   }
+
+  if( !next.views.empty() ) {
+    _AttachImageData(next.views, next.msg->mutable_camera());
+  }
+  return next.msg;
 }
 
-std::unique_ptr<hal::CameraMsg> Reader::ReadCameraMsg(int id) {
+std::shared_ptr<hal::CameraMsg> Reader::ReadCameraMsg(int id) {
   if( !m_bReadCamera ) {
     std::cerr << "warning: ReadCameraMsg was called but"
               << " ReadCamera variable is set to false! " << std::endl;
     return nullptr;
   }
 
-  // Wait if buffer is empty
-  std::unique_lock<std::mutex> lock(m_QueueMutex);
-  while(m_bRunning && !_AmINext( Msg_Type_Camera ) ){
-    m_ConditionQueued.wait_for(lock, std::chrono::milliseconds(10));
-  }
-
-  if(!m_bRunning || m_qMessages.empty()) {
+  QueuedMsg next;
+  if( !_Pop(Msg_Type_Camera, id, &next) ) {
     return nullptr;
   }
 
-  std::unique_ptr<hal::CameraMsg> pCameraMsg(new hal::CameraMsg);
-  pCameraMsg->Swap(m_qMessages.front()->mutable_camera());
+  _AttachImageData(next.views, next.msg->mutable_camera());
+  return SubMsgHandle(next.msg, next.msg->mutable_camera());
+}
 
-  m_qMessages.pop_front();
-  m_qMessageTypes.pop_front();
-  m_ConditionDequeued.notify_one();
+std::unique_ptr<hal::MappedCameraMsg> Reader::ReadMappedCameraMsg(int id) {
+  if( !m_bReadCamera ) {
+    std::cerr << "warning: ReadMappedCameraMsg was called but"
+              << " ReadCamera variable is set to false! " << std::endl;
+    return nullptr;
+  }
 
-  // message popped above might be some other id than the one wanted.
-  // this might cause some frame dropping.
-  if(id >= 0 && pCameraMsg->id() != id) {
+  QueuedMsg next;
+  if( !_Pop(Msg_Type_Camera, id, &next) ) {
     return nullptr;
   }
 
-  return pCameraMsg;
+  return std::unique_ptr<hal::MappedCameraMsg>(
+      new hal::MappedCameraMsg(next.msg, std::move(next.views),
+                               next.file));
 }
 
-std::unique_ptr<hal::ImuMsg> Reader::ReadImuMsg() {
+std::shared_ptr<hal::ImuMsg> Reader::ReadImuMsg() {
   if( !m_bReadIMU ) {
     std::cerr << "warning: ReadImuMsg was called but ReadIMU variable is set to false! " << std::endl;
     return nullptr;
   }
 
-  // Wait if buffer is empty
-  std::unique_lock<std::mutex> lock(m_QueueMutex);
-  while(m_bRunning && !_AmINext( Msg_Type_IMU ) ){
-    m_ConditionQueued.wait_for(lock, std::chrono::milliseconds(10));
-  }
-
-  if(!m_bRunning || m_qMessages.empty()) {
+  QueuedMsg next;
+  if( !_Pop(Msg_Type_IMU, -1, &next) ) {
     return nullptr;
   }
 
-  std::unique_ptr<hal::Msg> pMessage = std::move(m_qMessages.front());
-  m_qMessages.pop_front();
-  m_qMessageTypes.pop_front();
-  m_ConditionDequeued.notify_one();
-
-  std::unique_ptr<hal::ImuMsg> pImuMsg( new hal::ImuMsg );
-  pImuMsg->Swap( pMessage->mutable_imu() );
-  return pImuMsg;
+  return SubMsgHandle(next.msg, next.msg->mutable_imu());
 }
 
-std::unique_ptr<hal::LidarMsg> Reader::ReadLidarMsg() {
+std::shared_ptr<hal::LidarMsg> Reader::ReadLidarMsg() {
   if( !m_bReadLIDAR ) {
     std::cerr << "warning: ReadLidarMsg was called but ReadLIDAR variable is set to false! " << std::endl;
     return nullptr;
   }
 
-  // Wait if buffer is empty
-  std::unique_lock<std::mutex> lock(m_QueueMutex);
-  while(m_bRunning && !_AmINext( Msg_Type_LIDAR ) ){
-    m_ConditionQueued.wait_for(lock, std::chrono::milliseconds(10));
-  }
-
-  if(!m_bRunning || m_qMessages.empty()) {
+  QueuedMsg next;
+  if( !_Pop(Msg_Type_LIDAR, -1, &next) ) {
     return nullptr;
   }
 
-  std::unique_ptr<hal::Msg> pMessage = std::move(m_qMessages.front());
-  m_qMessages.pop_front();
-  m_qMessageTypes.pop_front();
-  m_ConditionDequeued.notify_one();
-
-  std::unique_ptr<hal::LidarMsg> pLidarMsg( new hal::LidarMsg );
-  pLidarMsg->Swap( pMessage->mutable_lidar() );
-  return pLidarMsg;
+  return SubMsgHandle(next.msg, next.msg->mutable_lidar());
 }
 
-std::unique_ptr<hal::PoseMsg> Reader::ReadPoseMsg() {
+std::shared_ptr<hal::PoseMsg> Reader::ReadPoseMsg() {
   if( !m_bReadPosys ) {
     std::cerr << "warning: ReadPoseMsg was called but ReadPose variable is set to false! " << std::endl;
     return nullptr;
   }
 
-  // Wait if buffer is empty
-  std::unique_lock<std::mutex> lock(m_QueueMutex);
-  while(m_bRunning && !_AmINext( Msg_Type_Posys ) ){
-    m_ConditionQueued.wait_for(lock, std::chrono::milliseconds(10));
-  }
-
-  if(!m_bRunning || m_qMessages.empty()) {
+  QueuedMsg next;
+  if( !_Pop(Msg_Type_Posys, -1, &next) ) {
     return nullptr;
   }
 
-  std::unique_ptr<hal::Msg> pMessage = std::move(m_qMessages.front());
-  m_qMessages.pop_front();
-  m_qMessageTypes.pop_front();
-  m_ConditionDequeued.notify_one();
-
-  std::unique_ptr<hal::PoseMsg> pPoseMsg( new hal::PoseMsg );
-  pPoseMsg->Swap( pMessage->mutable_pose() );
-  return pPoseMsg;
+  return SubMsgHandle(next.msg, next.msg->mutable_pose());
 }
 
 bool Reader::_BufferFromFile(const std::string& fileName) {
   m_sFilename = fileName;
-  m_bShouldRun = true;
-  m_ReadThread = std::thread( &Reader::_ThreadFunc, this );
+  if( LogManifest::IsManifest(m_sFilename) ) {
+    m_Manifest.Load(m_sFilename);
+  }
   return true;
 }
 
+void Reader::_StartThread() {
+  std::lock_guard<std::mutex> lock(m_ThreadMutex);
+  if( !m_bStarted ) {
+    m_bStarted = true;
+    m_bShouldRun = true;
+    m_ReadThread = std::thread( &Reader::_ThreadFunc, this );
+  }
+}
+
 void Reader::StopBuffering() {
-  if(m_bRunning)
+  _StopThread();
+
+  // Also ends reads on a reader which never started.
+  std::lock_guard<std::mutex> thread_lock(m_ThreadMutex);
+  m_bStarted = true;
+  std::lock_guard<std::mutex> lock(m_QueueMutex);
+  m_bRunning = false;
+  _NotifyReaders();
+}
+
+void Reader::SetMaxBufferSize(const int nNumMessages) {
+  std::lock_guard<std::mutex> lock(m_QueueMutex);
+  m_nMaxBufferSize = nNumMessages;
+  m_vMaxBufferSize.assign(m_vMaxBufferSize.size(), m_nMaxBufferSize);
+  m_ConditionDequeued.notify_all();
+}
+
+void Reader::SetMaxBufferSize(MessageType eType, size_t nNumMessages) {
+  std::lock_guard<std::mutex> lock(m_QueueMutex);
+  m_vMaxBufferSize.at(eType) = nNumMessages;
+  m_ConditionDequeued.notify_all();
+}
+
+size_t Reader::GetMaxBufferSize(MessageType eType) const {
+  return m_vMaxBufferSize.at(eType);
+}
+
+void Reader::SetNumDecodeThreads(unsigned int nThreads) {
+  m_nDecodeThreads = nThreads;
+}
+
+size_t Reader::_NumSegments() const {
+  return m_Manifest.Empty() ? 1 : m_Manifest.Size();
+}
+
+std::string Reader::_SegmentPath(size_t nSegment) const {
+  return m_Manifest.Empty() ? m_sFilename : m_Manifest.SegmentPath(nSegment);
+}
+
+bool Reader::_LoadIndex(size_t nSegment, bool bRebuild) {
+  if( nSegment != m_nIndexSegment ) {
+    m_Index.Clear();
+    m_nIndexSegment = nSegment;
+  }
+
+  const std::string sFilename = _SegmentPath(nSegment);
+  if( m_Index.Empty() && !m_Index.Load(sFilename) && bRebuild ) {
+    LOG(INFO) << "HAL: Log '" << sFilename << "' has no index, rebuilding.";
+    m_Index.Rebuild(sFilename);
+  }
+  return !m_Index.Empty();
+}
+
+void Reader::_StopThread() {
+  std::lock_guard<std::mutex> thread_lock(m_ThreadMutex);
   {
+    std::lock_guard<std::mutex> lock(m_QueueMutex);
     m_bShouldRun = false;
-    m_ConditionDequeued.notify_one();
+    m_ConditionDequeued.notify_all();
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_DecodeMutex);
+    m_DecodeSpace.notify_all();
   }
 
-  if(m_ReadThread.joinable()) {
+  if( m_ReadThread.joinable() ) {
     m_ReadThread.join();
   }
+}
 
-  m_ConditionQueued.notify_all();
+void Reader::_RestartThread() {
+  // kill reading thread if alive
+  _StopThread();
+
+  std::lock_guard<std::mutex> thread_lock(m_ThreadMutex);
+
+  // Streams stay in place: readers may be waiting on them.
+  {
+    std::lock_guard<std::mutex> lock(m_QueueMutex);
+    for( auto& it : m_mStreams ) {
+      it.second.queue.clear();
+    }
+    m_nNextSequence = 0;
+    m_bRunning = true;
+    m_bShouldRun = true;
+  }
+
+  m_bStarted = true;
+  m_ReadThread = std::thread( &Reader::_ThreadFunc, this );
 }
 
-bool Reader::SetInitialImage(size_t nImgID) {
+void Reader::SetMemoryMapped(bool bMemoryMapped) {
+  if( bMemoryMapped != m_bMemoryMapped ) {
+    _StopThread();
+    m_bMemoryMapped = bMemoryMapped;
+    _RestartThread();
+  }
+}
+
+bool Reader::_FindImage(size_t nImgID, StartPosition* pStart) {
   if( m_sFilename.empty() ) {
     return false;
   }
 
-  // kill reading thread if alive
-  if( m_ReadThread.joinable() ) {
-    m_bShouldRun = false;
-    m_ReadThread.join();
-    m_qMessages.clear();
-    m_qMessageTypes.clear();
+  size_t nSegment = 0;
+  size_t nLocalID = nImgID;
+  if( !m_Manifest.Empty() &&
+      !m_Manifest.FindMessage(nImgID, &nSegment, &nLocalID) ) {
+    LOG(WARNING) << "HAL: Log '" << m_sFilename << "' ends before message "
+                 << nImgID << ".";
+    return false;
+  }
+
+  pStart->segment = nSegment;
+  pStart->image = nLocalID;
+  pStart->offset = 0;
+  if( nLocalID > 0 && _LoadIndex(nSegment, false) &&
+      nLocalID < m_Index.Size() ) {
+    pStart->offset = m_Index[nLocalID].offset;
+  }
+  return true;
+}
+
+bool Reader::_FindTime(double dSeconds, StartPosition* pStart) {
+  if( m_sFilename.empty() ) {
+    return false;
   }
 
-  m_nInitialImageID = nImgID;
+  // Segmented logs start with the earliest message of the first segment.
+  size_t nSegment = 0;
+  double dTime = dSeconds;
+  if( !m_Manifest.Empty() ) {
+    dTime += m_Manifest[0].start_time();
+    nSegment = m_Manifest.FindTime(dTime);
+  }
+
+  if( nSegment == _NumSegments() || !_LoadIndex(nSegment, true) ) {
+    LOG(WARNING) << "HAL: Log '" << m_sFilename << "' ends before "
+                 << dSeconds << "s.";
+    return false;
+  }
+
+  if( m_Manifest.Empty() ) {
+    dTime += m_Index[0].timestamp;
+  }
+
+  const size_t nImgID = m_Index.FindTime(dTime);
+  if( nImgID == m_Index.Size() ) {
+    LOG(WARNING) << "HAL: Log '" << m_sFilename << "' ends before "
+                 << dSeconds << "s.";
+    return false;
+  }
+
+  pStart->segment = nSegment;
+  pStart->image = nImgID;
+  pStart->offset = m_Index[nImgID].offset;
+  return true;
+}
+
+void Reader::_SetStart(const StartPosition& start) {
+  m_nInitialSegment = start.segment;
+  m_nInitialImageID = start.image;
+  m_nInitialOffset = start.offset;
+}
+
+bool Reader::SetInitialImage(size_t nImgID) {
+  StartPosition start;
+  if( !_FindImage(nImgID, &start) ) {
+    return false;
+  }
+
+  _StopThread();
+  _SetStart(start);
   m_bReadCamera = true;
-  m_bShouldRun = true;
-  m_ReadThread = std::thread( &Reader::_ThreadFunc, this );
+  _RestartThread();
+  return true;
+}
+
+bool Reader::SetInitialTime(double dSeconds) {
+  StartPosition start;
+  if( !_FindTime(dSeconds, &start) ) {
+    return false;
+  }
+
+  _StopThread();
+  _SetStart(start);
+  _RestartThread();
+  return true;
+}
+
+bool Reader::Configure(const ReaderOptions& options) {
+  std::lock_guard<std::mutex> thread_lock(m_ThreadMutex);
+  if( m_bStarted || m_bConfigured ) {
+    LOG_IF(WARNING, !(options == m_Options))
+        << "HAL: Log '" << m_sFilename << "' is already read with other "
+        << "settings, ignoring these.";
+    return options == m_Options;
+  }
+
+  // Nothing reads yet: no thread to stop.
+  m_bConfigured = true;
+  m_Options = options;
+  m_bMemoryMapped = options.memory_mapped;
+  m_nDecodeThreads = options.decode_threads;
+  StartPosition start;
+  if( (options.start_time > 0 && _FindTime(options.start_time, &start)) ||
+      _FindImage(options.start_image, &start) ) {
+    _SetStart(start);
+  }
   return true;
 }
 
@@ -366,6 +1028,10 @@ void Reader::DisableAll() {
   m_bReadIMU = false;
   m_bReadLIDAR = false;
   m_bReadPosys = false;
+
+  std::lock_guard<std::mutex> lock(m_QueueMutex);
+  _NotifyReaders();
+  m_ConditionDequeued.notify_all();
 }
 
 void Reader::Enable(MessageType type) {
@@ -404,6 +1070,31 @@ void Reader::Disable(MessageType type) {
     default:
       LOG(FATAL) << "Incorrect message type given to Reader::Disable";
   }
+
+  std::lock_guard<std::mutex> lock(m_QueueMutex);
+  _NotifyReaders();
+  m_ConditionDequeued.notify_all();
+}
+
+void Reader::EnableCamera(int id) {
+  std::lock_guard<std::mutex> thread_lock(m_ThreadMutex);
+  std::lock_guard<std::mutex> lock(m_QueueMutex);
+  m_bReadCamera = true;
+  LOG_IF(WARNING, m_bStarted && !_IsRead(StreamKey(Msg_Type_Camera, id)))
+      << "HAL: Camera " << id << " of log '" << m_sFilename
+      << "' enabled after reading started, its earlier frames were skipped.";
+  m_bCamerasById = true;
+  m_sCameraReaders.insert(id);
+  _DropUnreadCameras();
+}
+
+void Reader::DisableCamera(int id) {
+  std::lock_guard<std::mutex> lock(m_QueueMutex);
+  auto it = m_sCameraReaders.find(id);
+  if( it != m_sCameraReaders.end() ) {
+    m_sCameraReaders.erase(it);
+  }
+  _DropUnreadCameras();
 }
 
 bool Reader::IsEnabled(MessageType type) const {
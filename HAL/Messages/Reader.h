@@ -2,15 +2,24 @@
 
 #include <fstream>
 
+#include <atomic>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 
-#include <list>
+#include <deque>
+#include <map>
+#include <set>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include <HAL/Header.pb.h>
 #include <HAL/Messages.pb.h>
+#include <HAL/Messages/LogIndex.h>
+#include <HAL/Messages/LogManifest.h>
+#include <HAL/Messages/MappedLog.h>
+#include <HAL/Messages/MsgArena.h>
 
 namespace hal {
 
@@ -21,109 +30,339 @@ enum MessageType {
   Msg_Type_Posys
 };
 
+/// How a reader shared by several drivers reads its log, see
+/// Reader::Configure().
+struct ReaderOptions {
+  ReaderOptions()
+      : memory_mapped(false), decode_threads(0), start_time(0),
+        start_image(0) {}
+
+  bool operator==(const ReaderOptions& other) const {
+    return memory_mapped == other.memory_mapped &&
+        decode_threads == other.decode_threads &&
+        start_time == other.start_time && start_image == other.start_image;
+  }
+
+  /// See Reader::SetMemoryMapped().
+  bool         memory_mapped;
+
+  /// See Reader::SetNumDecodeThreads().
+  unsigned int decode_threads;
+
+  /// Seconds into the log to start at, see Reader::SetInitialTime().
+  /// Starts at `start_image` if 0, or past the end of the log.
+  double       start_time;
+
+  /// See Reader::SetInitialImage().
+  size_t       start_image;
+};
+
+/// Reads a log, or the segments listed in a log manifest as one
+/// continuous log (see hal::LogManifest), on a background thread.
+///
+/// Messages are queued per stream: one queue per message type, and one
+/// per camera for camera messages. Each queue has its own bound, so a
+/// slow consumer of one stream only holds up the others once its queue
+/// is full. Readers of some cameras only enable them by id (see
+/// EnableCamera()): the other cameras are then skipped rather than hold
+/// up the read thread. The thread starts with the first read, after
+/// the streams and cameras to read have been enabled.
+///
+/// Messages are parsed into protobuf arenas shared by batches of
+/// messages (see hal::MsgArena). The handles handed out keep their
+/// batch alive; hold on to them no longer than needed, or move the
+/// message out with hal::MoveMsg().
 class Reader {
  public:
+  /// Reader of the given log shared by everyone who opens it, e.g. the
+  /// camera and IMU drivers replaying one log, with the given message
+  /// type enabled. The reader lives as long as someone holds it, and
+  /// any number of logs can be open at once.
+  static std::shared_ptr<Reader> Open(const std::string& filename,
+                                      MessageType eType);
+
+  /// Process-wide reader of the first log ever asked for. Prefer Open().
   static Reader& Instance(const std::string& filename, MessageType eType);
 
   Reader(const std::string& filename);
   ~Reader();
 
-  /// Reads message regardless of type. This allows the user to handle
-  /// the message list directly.
+  /// Reads message regardless of type, the earliest queued one in log
+  /// order. This allows the user to handle the message list directly.
   ///
-  /// This will block if no messages are in the queue.
-  std::unique_ptr<hal::Msg> ReadMessage();
+  /// This will block if no messages are in the queue. Returns null at
+  /// the end of the log.
+  std::shared_ptr<hal::Msg> ReadMessage();
 
-  /// Reads the next camera message from the message queue. If the
-  /// next message is NOT a camera message, or the message queue is
-  /// empty, the function will block. Mostly used for camera specific
-  /// driver implementations.
+  /// Reads the next camera message from the queue of the given camera.
+  /// Blocks until one is queued; messages of other streams, including
+  /// other cameras, stay queued for their readers. Mostly used for
+  /// camera specific driver implementations.
   ///
   /// The "ReadCamera" static variable must be set to true if the
   /// reader is to queue camera messages.
   ///
   /// @param id ID of camera to return. Negative number indicates that
-  ///           any camera messsage should be returned.
-  std::unique_ptr<hal::CameraMsg> ReadCameraMsg(int id = -1);
+  ///           the earliest message of any camera should be returned.
+  ///
+  /// The message owns its image data: when memory mapped, the data is
+  /// copied out of the mapping here.
+  std::shared_ptr<hal::CameraMsg> ReadCameraMsg(int id = -1);
 
-  /// Reads the next IMU message from the message queue. If the next
-  /// message is NOT an IMU message, or the message queue is empty,
-  /// the function will block. Mostly used for IMU specific driver
-  /// implementations.
+  /// Same as ReadCameraMsg, but the returned handle does not copy the
+  /// image data. When the reader is memory mapped, it points straight
+  /// into the mapped log. The only read which is zero-copy.
+  std::unique_ptr<hal::MappedCameraMsg> ReadMappedCameraMsg(int id = -1);
+
+  /// Reads the next IMU message from the IMU queue, blocking while it
+  /// is empty. Mostly used for IMU specific driver implementations.
   ///
   /// The "ReadIMU" static variable must be set to true if the reader
   /// is to queue IMU messages.
-  std::unique_ptr<hal::ImuMsg> ReadImuMsg();
+  std::shared_ptr<hal::ImuMsg> ReadImuMsg();
 
-  /// Reads the next LIDAR message from the message queue. If the next
-  /// message is NOT a LIDAR message, or the message queue is empty,
-  /// the function will block. Mostly used for LIDAR specific driver
+  /// Reads the next LIDAR message from the LIDAR queue, blocking while
+  /// it is empty. Mostly used for LIDAR specific driver
   /// implementations.
   ///
   /// The "ReadLidar" static variable must be set to true if the
   /// reader is to queue LIDAR messages.
-  std::unique_ptr<hal::LidarMsg> ReadLidarMsg();
+  std::shared_ptr<hal::LidarMsg> ReadLidarMsg();
 
-  /// Reads the next POSE message from the message queue. If the next
-  /// message is NOT a POSE message, or the message queue is empty,
-  /// the function will block. Mostly used for POSYS specific driver
-  /// implementations.
+  /// Reads the next POSE message from the POSE queue, blocking while it
+  /// is empty. Mostly used for POSYS specific driver implementations.
   ///
   /// The "ReadPose" static variable must be set to true if the reader
   /// is to queue POSE messages.
-  std::unique_ptr<hal::PoseMsg> ReadPoseMsg();
+  std::shared_ptr<hal::PoseMsg> ReadPoseMsg();
 
   /// Stops the buffering thread. Should be called by driver
   /// implementations, usually in their destructors.
   void StopBuffering();
 
-  /// Reset reader to use specified initial image
+  /// Read the log through a memory mapping of the file rather than
+  /// read() calls. Messages are then parsed straight out of the mapping
+  /// without copying image data until it is asked for: only
+  /// ReadMappedCameraMsg hands it out without a copy. Restarts reading
+  /// at the initial message.
+  void SetMemoryMapped(bool bMemoryMapped);
+  bool IsMemoryMapped() const { return m_bMemoryMapped; }
+
+  /// Reset reader to use specified initial image. Seeks directly to it
+  /// when the log has an index, skips over the preceding records
+  /// otherwise. Images of a segmented log are counted across segments.
   bool SetInitialImage(size_t nImgID);
 
-  /// Getters and setters for max buffer size
-  void SetMaxBufferSize(const int nNumMessages) {
-    m_nMaxBufferSize = nNumMessages;
-  }
+  /// Reset reader to start at the first message stamped at least
+  /// dSeconds after the first message of the log. Uses the log's index,
+  /// or rebuilds it from the record framing if the log has none.
+  bool SetInitialTime(double dSeconds);
+
+  /// Apply the options a driver sharing the reader asks for, unless
+  /// reading started or another driver configured the reader already:
+  /// the reader is never restarted under the other drivers. Returns
+  /// false, with a warning, if the options differ from those in effect.
+  bool Configure(const ReaderOptions& options);
+
+  /// Getters and setters for max buffer size, the number of messages
+  /// queued per stream.
+  void SetMaxBufferSize(const int nNumMessages);
   size_t GetMaxBufferSize() const { return m_nMaxBufferSize; }
 
-  /// Return the log's filename.
+  /// Bound the queues of one message type, e.g. to let IMU messages run
+  /// further ahead of a slow camera consumer.
+  void SetMaxBufferSize(MessageType eType, size_t nNumMessages);
+  size_t GetMaxBufferSize(MessageType eType) const;
+
+  /// Parse messages on this many threads while the read thread only
+  /// splits the log into records. Messages are still queued in log
+  /// order. 0 parses on the read thread. Takes effect when reading
+  /// (re)starts, i.e. call it before the first read.
+  void SetNumDecodeThreads(unsigned int nThreads);
+  unsigned int GetNumDecodeThreads() const { return m_nDecodeThreads; }
+
+  /// Return the log's filename, i.e. the manifest of a segmented log.
   std::string GetFilename() const { return m_sFilename; }
 
+  /// True if the file is a manifest of a segmented log.
+  bool IsSegmented() const { return !m_Manifest.Empty(); }
+
   /// Return Header protobuf.
   const hal::Header& GetHeader() const { return m_Header; }
 
   bool IsRunning() const { return m_bRunning; }
 
+  /// Streams must be enabled before the first read to see the start
+  /// of the log. Disabling a stream ends reads blocked on it, e.g. when
+  /// one of the drivers sharing a reader shuts down.
   void Enable(MessageType type);
   void Disable(MessageType type);
   void EnableAll();
   void DisableAll();
   bool IsEnabled(MessageType type) const;
 
+  /// Read camera `id`, or every camera if negative, and no others
+  /// unless enabled too. Every camera is read until the first call.
+  /// Called up front by camera drivers sharing the reader: frames of a
+  /// camera enabled once reading started may have been skipped.
+  void EnableCamera(int id);
+
+  /// Undo one EnableCamera(id) call, e.g. when a camera driver sharing
+  /// the reader shuts down. Cameras nobody enabled any more are
+  /// skipped, and their queued messages dropped.
+  void DisableCamera(int id);
+
  private:
   /// Buffer from file.
   bool _BufferFromFile(const std::string &fileName);
 
-  bool _AmINext( MessageType eMsgType );
+  /// Number of files the log is made of and their paths.
+  size_t _NumSegments() const;
+  std::string _SegmentPath(size_t nSegment) const;
+
+  /// Load the index of a segment, rebuilding it if asked and there is
+  /// none.
+  bool _LoadIndex(size_t nSegment, bool bRebuild);
+
+  /// Start the read thread unless it was started (or stopped) before.
+  void _StartThread();
+
+  /// Stop the read thread, if running, before changing what it reads.
+  void _StopThread();
+
+  /// (Re)start the read thread at the configured initial message.
+  void _RestartThread();
+
+  /// Where reading starts: a message of a segment, and its offset in
+  /// the segment if known (0 otherwise).
+  struct StartPosition {
+    StartPosition() : segment(0), image(0), offset(0) {}
+
+    size_t   segment;
+    size_t   image;   // In segment.
+    uint64_t offset;
+  };
+
+  /// Find the given message, or the first one stamped at least
+  /// dSeconds into the log. Returns false past the end of the log.
+  bool _FindImage(size_t nImgID, StartPosition* pStart);
+  bool _FindTime(double dSeconds, StartPosition* pStart);
+
+  /// Start reading at `start` the next time the thread (re)starts.
+  void _SetStart(const StartPosition& start);
+
   void _ThreadFunc();
 
+  /// Read one log file through a file stream or a memory mapping,
+  /// starting at the given message (and its offset, if known).
+  void _ReadLog(const std::string& sFilename, size_t nInitialImageID,
+                uint64_t nInitialOffset);
+  void _ReadMappedLog(const std::string& sFilename, size_t nInitialImageID,
+                      uint64_t nInitialOffset);
+
+  /// Queue a message read from the log, along with the mapping holding
+  /// its image data, if any. Blocks while the queue of its stream is
+  /// full. Returns false at the end of the log file or when stopped.
+  bool _Enqueue(std::shared_ptr<hal::Msg> pMsg, std::vector<ImageView> vViews,
+                std::shared_ptr<const MappedFile> pFile);
+
+  /// A record split off the log, waiting for a decode thread.
+  struct RawRecord {
+    RawRecord() : seq(0), record(nullptr), size(0) {}
+
+    uint64_t                          seq;     // Position in the log.
+    std::string                       data;    // Record read from file,
+    const unsigned char*              record;  // or the record in `file`.
+    uint32_t                          size;
+    std::shared_ptr<const MappedFile> file;
+  };
+
+  /// Hand a record to the decode threads. Blocks while they are busy.
+  /// Returns false when stopped.
+  bool _QueueRecord(RawRecord record);
+
+  /// Decode thread: parse records and queue them in log order.
+  void _DecodeFunc();
+
+  /// A message waiting to be read.
+  struct QueuedMsg {
+    uint64_t                          seq;    // Position in the log.
+    std::shared_ptr<hal::Msg>         msg;    // In a batch's arena.
+    std::vector<ImageView>            views;  // Image data left mapped.
+    std::shared_ptr<const MappedFile> file;   // Mapping holding the views.
+  };
+
+  /// Messages of one type, or of one camera.
+  struct Stream {
+    std::deque<QueuedMsg>   queue;
+    std::condition_variable queued;
+  };
+
+  /// Message type and camera id (-1 for other types) of a stream.
+  typedef std::pair<MessageType, int> StreamKey;
+
+  /// True if the stream is enabled, and its camera too. Must hold
+  /// m_QueueMutex.
+  bool _IsRead(const StreamKey& key) const;
+
+  /// Drop the messages of cameras no longer read and wake whoever waits
+  /// on them. Must hold m_QueueMutex.
+  void _DropUnreadCameras();
+
+  /// Block until a message of the given type (any if negative) and
+  /// camera id (any camera if negative) is queued, and pop the earliest
+  /// one. Returns false at the end of the log.
+  bool _Pop(int nType, int nId, QueuedMsg* pNext);
+
+  /// Wake every reader, e.g. at the end of the log. Must hold
+  /// m_QueueMutex.
+  void _NotifyReaders();
+
+  /// Copy image data left in a memory mapping into the message.
+  static void _AttachImageData(const std::vector<ImageView>& vViews,
+                               hal::CameraMsg* pCameraMsg);
+
  private:
   std::string                             m_sFilename;
+  hal::LogManifest                        m_Manifest;
   hal::Header                              m_Header;
-  bool                                    m_bRunning;
-  bool                                    m_bShouldRun;
-  bool                                    m_bReadCamera;
-  bool                                    m_bReadIMU;
-  bool                                    m_bReadLIDAR;
-  bool                                    m_bReadPosys;
-  std::list<std::unique_ptr<hal::Msg> >    m_qMessages;
-  std::list<MessageType >                 m_qMessageTypes;
+  std::atomic<bool>                       m_bRunning;
+  std::atomic<bool>                       m_bShouldRun;
+  std::atomic<bool>                       m_bReadCamera;
+  std::atomic<bool>                       m_bReadIMU;
+  std::atomic<bool>                       m_bReadLIDAR;
+  std::atomic<bool>                       m_bReadPosys;
+  bool                                    m_bMemoryMapped;
+  std::map<StreamKey, Stream>             m_mStreams;
+  std::multiset<int>                      m_sCameraReaders;  // Enabled ids.
+  bool                                    m_bCamerasById;
+  uint64_t                                m_nNextSequence;
   std::mutex                              m_QueueMutex;
-  std::condition_variable                 m_ConditionQueued;
+  std::condition_variable                 m_ConditionQueued;   // Any stream.
   std::condition_variable                 m_ConditionDequeued;
+  std::mutex                              m_ThreadMutex;
+  bool                                    m_bStarted;
+  bool                                    m_bConfigured;
+  ReaderOptions                           m_Options;  // Of Configure().
   std::thread                             m_ReadThread;
-  size_t                                  m_nInitialImageID;
+  size_t                                  m_nInitialSegment;
+  size_t                                  m_nInitialImageID;  // In segment.
+  uint64_t                                m_nInitialOffset;
+  hal::LogIndex                           m_Index;
+  size_t                                  m_nIndexSegment;
   size_t                                  m_nMaxBufferSize;
+  std::vector<size_t>                     m_vMaxBufferSize;  // Per type.
+
+  std::atomic<unsigned int>               m_nDecodeThreads;
+  unsigned int                            m_nDecoders;  // Of the thread.
+  std::mutex                              m_DecodeMutex;
+  std::condition_variable                 m_DecodeQueued;
+  std::condition_variable                 m_DecodeSpace;
+  std::condition_variable                 m_DecodeTurn;
+  std::deque<RawRecord>                   m_qRecords;
+  uint64_t                                m_nNextRecord;
+  uint64_t                                m_nNextToQueue;
+  bool                                    m_bFramingDone;
 };
 
 }  // end namespace hal
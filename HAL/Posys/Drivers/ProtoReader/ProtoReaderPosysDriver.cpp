@@ -5,7 +5,7 @@ using namespace hal;
 
 /////////////////////////////////////////////////////////////////////////////////////////
 ProtoReaderPosysDriver::ProtoReaderPosysDriver(std::string filename)
-    : m_reader(hal::Reader::Instance(filename,hal::Msg_Type_Posys)), m_running(false), m_callback(nullptr)
+    : m_reader(hal::Reader::Open(filename,hal::Msg_Type_Posys)), m_running(false), m_callback(nullptr)
 {
 }
 
@@ -14,7 +14,7 @@ ProtoReaderPosysDriver::ProtoReaderPosysDriver(std::string filename)
 void ProtoReaderPosysDriver::_ThreadFunc()
 {
     while( m_running ) {
-        std::unique_ptr<hal::PoseMsg> readmsg = m_reader.ReadPoseMsg();
+        std::shared_ptr<hal::PoseMsg> readmsg = m_reader->ReadPoseMsg();
         if(readmsg) {
             m_callback( *readmsg );
         } else {
@@ -28,7 +28,8 @@ void ProtoReaderPosysDriver::_ThreadFunc()
 ProtoReaderPosysDriver::~ProtoReaderPosysDriver()
 {
     m_running = false;
-    m_reader.StopBuffering();
+    // Ends the read on our thread; other drivers may share the reader.
+    m_reader->Disable(hal::Msg_Type_Posys);
     m_callbackThread.join();
 }
 
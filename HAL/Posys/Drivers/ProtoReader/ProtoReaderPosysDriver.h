@@ -20,7 +20,7 @@ private:
     void _ThreadFunc();
 
 private:
-    hal::Reader&                 m_reader;
+    std::shared_ptr<hal::Reader> m_reader;
     bool                        m_running;
     std::thread                 m_callbackThread;
     PosysDriverDataCallback     m_callback;
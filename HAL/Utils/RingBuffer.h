@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace hal {
+
+/**
+ * Bounded lock-free multi-producer, multi-consumer ring buffer.
+ *
+ * Slots are allocated once and reused: producers fill a slot in place
+ * and consumers work on it in place before releasing it, so slot types
+ * that keep their storage when cleared (e.g. protobuf messages) stop
+ * allocating once the buffer has warmed up.
+ *
+ * Each slot carries a sequence number which tells whether it is free
+ * for the producer claiming position `pos` (seq == pos) or holds the
+ * element written at `pos` (seq == pos + 1). See D. Vyukov's bounded
+ * MPMC queue.
+ */
+template <typename T>
+class MpmcRingBuffer {
+ public:
+  /// `capacity` is at least 2: with a single cell, its sequence number
+  /// can't tell a slot freed for the next lap from a published one.
+  explicit MpmcRingBuffer(size_t capacity)
+      : cells_(capacity > 2 ? capacity : 2), head_(0), tail_(0) {
+    for (size_t ii = 0; ii < cells_.size(); ++ii) {
+      cells_[ii].seq.store(ii, std::memory_order_relaxed);
+    }
+  }
+
+  MpmcRingBuffer(const MpmcRingBuffer&) = delete;
+  MpmcRingBuffer& operator=(const MpmcRingBuffer&) = delete;
+
+  /// Claim a free slot, let `fill` write the element into it and
+  /// publish it. Returns false without calling `fill` if the buffer is
+  /// full. Safe to call from any number of threads.
+  template <typename Fill>
+  bool TryPush(Fill&& fill) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos % cells_.size()];
+      const size_t seq = cell->seq.load(std::memory_order_acquire);
+      const ptrdiff_t diff =
+          static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+
+    fill(cell->value);
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Claim the oldest published element, let `consume` work on it in
+  /// place and release its slot to the producers. Returns false
+  /// without calling `consume` if the buffer is empty. Safe to call
+  /// from any number of threads.
+  template <typename Consume>
+  bool TryPop(Consume&& consume) {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos % cells_.size()];
+      const size_t seq = cell->seq.load(std::memory_order_acquire);
+      const ptrdiff_t diff =
+          static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos + 1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+
+    consume(cell->value);
+    cell->seq.store(pos + cells_.size(), std::memory_order_release);
+    return true;
+  }
+
+  /// Number of claimed slots. Only a snapshot when called concurrently.
+  size_t Size() const {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t head = head_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  bool Empty() const { return Size() == 0; }
+
+  size_t Capacity() const { return cells_.size(); }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    T                   value;
+  };
+
+  // Head and tail are kept on separate cache lines: they are written
+  // by the consumers and the producers respectively.
+  std::vector<Cell>   cells_;
+  std::atomic<size_t> head_;
+  char                pad_[64];
+  std::atomic<size_t> tail_;
+};
+
+}  // namespace hal
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hal {
+
+/**
+ * A few persistent threads running the tasks of one batch at a time,
+ * e.g. the channels of a frame, along with the thread calling Run().
+ * Saves starting threads per frame in drivers which work on channels
+ * in parallel.
+ */
+class WorkerPool {
+ public:
+  /// `nThreads` threads in all, counting the one calling Run().
+  explicit WorkerPool(unsigned int nThreads)
+      : m_pTask(nullptr), m_nNext(0), m_nTasks(0), m_nPending(0),
+        m_bShouldRun(true) {
+    for (unsigned int ii = 1; ii < nThreads; ++ii) {
+      m_vWorkers.emplace_back(&WorkerPool::WorkerFunc, this);
+    }
+  }
+
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_bShouldRun = false;
+    }
+    m_WorkReady.notify_all();
+    for (std::thread& worker : m_vWorkers) {
+      worker.join();
+    }
+  }
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  /// Call `task` with 0 to `nTasks` - 1, returning once all are done.
+  /// Not to be called by two threads at once.
+  void Run(size_t nTasks, const std::function<void(size_t)>& task) {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_pTask = &task;
+    m_nNext = 0;
+    m_nTasks = nTasks;
+    m_nPending = nTasks;
+    if (nTasks > 1 && !m_vWorkers.empty()) {
+      m_WorkReady.notify_all();
+    }
+    RunTasks(lock);
+    m_WorkDone.wait(lock, [this] { return m_nPending == 0; });
+    m_pTask = nullptr;
+  }
+
+ private:
+  void WorkerFunc() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true) {
+      m_WorkReady.wait(lock, [this] {
+        return !m_bShouldRun || (m_pTask && m_nNext < m_nTasks);
+      });
+      if (!m_bShouldRun) {
+        return;
+      }
+      RunTasks(lock);
+    }
+  }
+
+  /// Take tasks of the current batch until none are left.
+  void RunTasks(std::unique_lock<std::mutex>& lock) {
+    while (m_pTask && m_nNext < m_nTasks) {
+      const std::function<void(size_t)>& task = *m_pTask;
+      const size_t nTask = m_nNext++;
+      lock.unlock();
+      task(nTask);
+      lock.lock();
+      if (--m_nPending == 0) {
+        m_WorkDone.notify_all();
+      }
+    }
+  }
+
+  std::vector<std::thread>                 m_vWorkers;
+  std::mutex                               m_Mutex;
+  std::condition_variable                  m_WorkReady;
+  std::condition_variable                  m_WorkDone;
+  const std::function<void(size_t)>*       m_pTask;
+  size_t                                   m_nNext;
+  size_t                                   m_nTasks;
+  size_t                                   m_nPending;
+  bool                                     m_bShouldRun;
+};
+
+}  // namespace hal
@@ -0,0 +1,128 @@
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <HAL/Messages/Logger.h>
+#include <HAL/Messages/Reader.h>
+
+namespace {
+
+/// Log `nFrames` frames of cameras 0 and 1, interleaved.
+void WriteTwoCameraLog(const std::string& sFilename, int nFrames) {
+  hal::Logger logger;
+  logger.SetBackpressurePolicy(hal::Logger::Backpressure_Block);
+  logger.LogToFile(sFilename);
+  for (int ii = 0; ii < 2 * nFrames; ++ii) {
+    hal::Msg msg;
+    msg.set_timestamp(ii);
+    hal::CameraMsg* pCamera = msg.mutable_camera();
+    pCamera->set_id(ii % 2);
+    hal::ImageMsg* pImage = pCamera->add_image();
+    pImage->set_width(4);
+    pImage->set_height(2);
+    pImage->set_type(hal::PB_UNSIGNED_BYTE);
+    pImage->set_format(hal::PB_LUMINANCE);
+    pImage->set_data(std::string(8, static_cast<char>(ii)));
+    ASSERT_TRUE(logger.LogMessage(msg));
+  }
+  logger.StopLogging();
+}
+
+}  // namespace
+
+// A reader of one camera used to stall the read thread once the queue
+// of the other camera, which nobody reads, filled up.
+TEST(Reader, OneOfTwoCameras) {
+  const std::string sFilename = testing::TempDir() + "two_cameras.log";
+  const int kFrames = 20;
+  WriteTwoCameraLog(sFilename, kFrames);
+
+  hal::Reader reader(sFilename);
+  reader.EnableCamera(0);
+  reader.SetMaxBufferSize(4);
+
+  int nFrames = 0;
+  while (std::shared_ptr<hal::CameraMsg> pCamera = reader.ReadCameraMsg(0)) {
+    EXPECT_EQ(0, pCamera->id());
+    ASSERT_EQ(1, pCamera->image_size());
+    EXPECT_EQ(std::string(8, static_cast<char>(2 * nFrames)),
+              pCamera->image(0).data());
+    ++nFrames;
+  }
+  EXPECT_EQ(kFrames, nFrames);
+}
+
+// Readers of every camera still see all of them.
+TEST(Reader, AllCameras) {
+  const std::string sFilename = testing::TempDir() + "all_cameras.log";
+  const int kFrames = 20;
+  WriteTwoCameraLog(sFilename, kFrames);
+
+  hal::Reader reader(sFilename);
+  reader.Enable(hal::Msg_Type_Camera);
+  reader.SetMaxBufferSize(4);
+
+  int nFrames = 0;
+  while (std::shared_ptr<hal::CameraMsg> pCamera = reader.ReadCameraMsg()) {
+    EXPECT_EQ(nFrames % 2, pCamera->id());
+    ++nFrames;
+  }
+  EXPECT_EQ(2 * kFrames, nFrames);
+}
+
+// Once the reader of a camera lets go, the other streams read on.
+TEST(Reader, DisableCamera) {
+  const std::string sFilename = testing::TempDir() + "disable_camera.log";
+  const int kFrames = 20;
+  WriteTwoCameraLog(sFilename, kFrames);
+
+  hal::Reader reader(sFilename);
+  reader.EnableCamera(0);
+  reader.EnableCamera(1);
+  reader.SetMaxBufferSize(4);
+
+  ASSERT_TRUE(reader.ReadCameraMsg(1) != nullptr);
+  reader.DisableCamera(1);
+  EXPECT_TRUE(reader.ReadCameraMsg(1) == nullptr);
+
+  int nFrames = 0;
+  while (std::shared_ptr<hal::CameraMsg> pCamera = reader.ReadCameraMsg(0)) {
+    EXPECT_EQ(std::string(8, static_cast<char>(2 * nFrames)),
+              pCamera->image(0).data());
+    ++nFrames;
+  }
+  EXPECT_EQ(kFrames, nFrames);
+}
+
+// Cameras enabled up front keep all their frames for a reader which
+// only starts reading later on.
+TEST(Reader, LateCameraReader) {
+  const std::string sFilename = testing::TempDir() + "late_camera.log";
+  const int kFrames = 20;
+  WriteTwoCameraLog(sFilename, kFrames);
+
+  hal::Reader reader(sFilename);
+  reader.EnableCamera(0);
+  reader.EnableCamera(1);
+  reader.SetMaxBufferSize(4);
+
+  int nFrames0 = 0;
+  std::thread first([&]() {
+      while (reader.ReadCameraMsg(0)) {
+        ++nFrames0;
+      }
+    });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  int nFrames1 = 0;
+  while (std::shared_ptr<hal::CameraMsg> pCamera = reader.ReadCameraMsg(1)) {
+    EXPECT_EQ(std::string(8, static_cast<char>(2 * nFrames1 + 1)),
+              pCamera->image(0).data());
+    ++nFrames1;
+  }
+  first.join();
+  EXPECT_EQ(kFrames, nFrames0);
+  EXPECT_EQ(kFrames, nFrames1);
+}
@@ -0,0 +1,16 @@
+# Find lz4
+#
+# LZ4_FOUND		True if lz4 was found
+# LZ4_INCLUDE_DIR		Directory with headers
+# LZ4_LIBRARIES		List of libraries
+#
+
+find_path(LZ4_INCLUDE_DIR "lz4.h")
+
+find_library(LZ4_LIBRARIES NAMES "lz4")
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args("LZ4" DEFAULT_MSG LZ4_INCLUDE_DIR LZ4_LIBRARIES)
+set(LZ4_FOUND ${LZ4_FOUND} CACHE BOOL "lz4 was found or not" FORCE)
+
+mark_as_advanced(LZ4_INCLUDE_DIR LZ4_LIBRARIES)
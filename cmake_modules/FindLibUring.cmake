@@ -0,0 +1,16 @@
+# Find liburing, the io_uring userspace library.
+#
+# LibUring_FOUND		True if liburing was found
+# LibUring_INCLUDE_DIR		Directory with headers
+# LibUring_LIBRARIES		List of libraries
+#
+
+find_path(LibUring_INCLUDE_DIR "liburing.h")
+
+find_library(LibUring_LIBRARIES NAMES "uring")
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args("LibUring" DEFAULT_MSG LibUring_INCLUDE_DIR LibUring_LIBRARIES)
+set(LibUring_FOUND ${LIBURING_FOUND} CACHE BOOL "liburing was found or not" FORCE)
+
+mark_as_advanced(LibUring_INCLUDE_DIR LibUring_LIBRARIES)
@@ -0,0 +1,16 @@
+# Find zstd
+#
+# Zstd_FOUND		True if zstd was found
+# Zstd_INCLUDE_DIR		Directory with headers
+# Zstd_LIBRARIES		List of libraries
+#
+
+find_path(Zstd_INCLUDE_DIR "zstd.h")
+
+find_library(Zstd_LIBRARIES NAMES "zstd")
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args("Zstd" DEFAULT_MSG Zstd_INCLUDE_DIR Zstd_LIBRARIES)
+set(Zstd_FOUND ${ZSTD_FOUND} CACHE BOOL "zstd was found or not" FORCE)
+
+mark_as_advanced(Zstd_INCLUDE_DIR Zstd_LIBRARIES)